@@ -6,9 +6,13 @@
 #include "HistogramStepDetector.hpp"
 #include "NoteDetector.hpp"
 #include "AudioReader.hpp"
-#include "FFmpegAudioReader.hpp"
+#include "AudioReaderFactory.hpp"
 #include "McLeodPitchExtractorMethod.hpp"
 #include "json.hpp"
+#ifdef _WIN32
+    #include <io.h>
+    #include <fcntl.h>
+#endif
 
 using json = nlohmann::json;
 
@@ -21,7 +25,8 @@ cxxopts::ParseResult parse(int argc, char* argv[]) {
 
     options.add_options()
         ("help", "Print help")
-        ("i, input",    "Input audio/video file [.mp3, .wav, .ogg, etc...] or json file for remaining saved conversion", cxxopts::value<std::string>())
+        ("i, input",    "Input audio/video file [.mp3, .wav, .ogg, etc...] or json file for remaining saved conversion "
+                        "('-' to read the audio from the standard input)", cxxopts::value<std::string>())
         ("o, output",   "Output file, .xml for MusicXML format, .mid for midi format, .json to save temporary conversion"
                         "(if you set '--complete' option, the output must be a folder)", cxxopts::value<std::string>())
         ("positional",  "input,output: these are the arguments that can be entered without an option", cxxopts::value<std::vector<std::string>>())
@@ -31,6 +36,8 @@ cxxopts::ParseResult parse(int argc, char* argv[]) {
                             "OR a json file containing a result of pitch conversion, the output file will be either a json "
                             "file [default] containing the detected step OR a midi file without rhythm interpolation.")
         ("complete",    "Perform all the steps and save all temporary results and scores in the specified folder set by '--output'")
+        ("segments",    "Number of time segments of the input decoded concurrently during the pitch conversion "
+                        "(1: the input is decoded sequentially)", cxxopts::value<unsigned int>()->default_value("1"))
         ;
 
     options.parse_positional({"input", "output", "positional"});
@@ -111,29 +118,43 @@ void loadPitchResult(PitchResult & pitch_result, const std::string & filepath) {
         }
     }
 }
-PitchResult performPitchDetection(const std::string & filepath) {
-    if(!exists(filepath)) {
+PitchResult performPitchDetection(const std::string & filepath, unsigned int nb_segments=1) {
+    if((filepath != "-") && !exists(filepath)) {
         throw std::runtime_error("File does not exists");
     }
     // Parameters 
     AudioReaderParameters reader_parameters;
     reader_parameters.windowstimesize_s = 20e-3;
     reader_parameters.period_s = 1e-3;
-    reader_parameters.resample_rate_hz = 44100;
+    reader_parameters.resample_rate_hz = AUTO_SAMPLE_RATE;
+    reader_parameters.sample_format = SampleFormat::DOUBLE;
+    reader_parameters.max_frequency_hz = 4200.0;
 
     McLeodParameters mcleod_parameters;
     mcleod_parameters.cutoff = 0.97;
     mcleod_parameters.small_cutoff = 0.5;
     mcleod_parameters.lower_pitch_cutoff = 50.0;
+    mcleod_parameters.upper_pitch_cutoff = 0.0;
+    mcleod_parameters.nsdf_method = NsdfMethod::FFT;
 
-    // Audio reader
-    FFmpegAudioReader audio_reader(filepath);
+    // Audio reader ('-': standard input, read without temporary file)
+    std::unique_ptr<AudioReader> audio_reader;
+    if(filepath == "-") {
+#ifdef _WIN32
+        // The standard input is opened in text mode (CR LF translation, 0x1A read as end of file)
+        _setmode(_fileno(stdin), _O_BINARY);
+#endif
+        audio_reader = create_audio_reader(std::make_shared<AudioInput>(std::cin, "stdin"));
+    } else {
+        audio_reader = create_audio_reader(filepath);
+    }
 
     // Pitch extractor method
     McLeodPitchExtractorMethod mcleod_method(mcleod_parameters);
 
     // Pitch detector
-    PitchDetector pitch_detector(&audio_reader, &mcleod_method);
+    PitchDetector pitch_detector(audio_reader.get(), &mcleod_method);
+    pitch_detector.setNumberOfSegments(nb_segments);
     PitchResult result = pitch_detector.perform(nullptr, reader_parameters);
 
     return result;
@@ -264,7 +285,7 @@ int main(int argc, char* argv[])
     // loadStepResult(step_result, "step_result.json");
 
     // Pitch extraction
-    PitchResult pitch_result = performPitchDetection(infilepath);
+    PitchResult pitch_result = performPitchDetection(infilepath, options["segments"].as<unsigned int>());
     writePitchResult(pitch_result, "pitch_result.json");
 
     // Step detection
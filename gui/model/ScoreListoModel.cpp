@@ -1,7 +1,7 @@
 #include "ScoreListoModel.hpp"
 #include "HistogramStepDetector.hpp"
 #include "MusicXmlScore.hpp"
-#include "FFmpegAudioReader.hpp"
+#include "AudioReaderFactory.hpp"
 #include <chrono>
 #include <thread>
 
@@ -137,7 +137,7 @@ int ScoreListoModel::fileOpening(ScoreListoModel * inst, std::string path) {
     emit inst->fileOpeningStarted();
     emit inst->taskProgressed(0.0);
     try {
-        inst->audio_reader = new FFmpegAudioReader(path);
+        inst->audio_reader = create_audio_reader(path).release();
         inst->setFilepath(path);
     } catch (...) {
         emit inst->fileOpeningFailed();
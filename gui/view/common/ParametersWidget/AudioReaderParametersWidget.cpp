@@ -100,7 +100,7 @@ void AudioReaderParametersWidget::setParameters(const AudioReaderParameters & pa
 
 
 AudioReaderParameters AudioReaderParametersWidget::getParameters() {
-    AudioReaderParameters parameters;
+    AudioReaderParameters parameters = DEFAULT_AUDIO_READER_PARAMETERS;
     parameters.period_s = this->period->text().toDouble() / 1000.0;
     parameters.windowstimesize_s = this->windows_size->text().toDouble() / 1000.0;
     if(this->resampled->isChecked()) {
@@ -18,18 +18,22 @@ McLeodParametersWidget::McLeodParametersWidget(QWidget *parent/*=nullptr*/): QGr
     this->cutoff = new QLineEdit;
     this->small_cutoff = new QLineEdit;
     this->lower_pitch_cutoff = new QLineEdit;
+    this->upper_pitch_cutoff = new QLineEdit;
     QLabel* cutoff_unit = new QLabel("[0-1]");
     QLabel* smcutoff_unit = new QLabel("[0-1]");
     QLabel* ptcutoff_unit = new QLabel("[Hz]");
+    QLabel* upcutoff_unit = new QLabel("[Hz]");
     /* Widgets (End) */
 
     /* Architecture */
     this->cutoff->setFixedWidth(80);
     this->small_cutoff->setFixedWidth(80);
     this->lower_pitch_cutoff->setFixedWidth(80);
+    this->upper_pitch_cutoff->setFixedWidth(80);
     cutoff_unit->setFixedWidth(35);
     smcutoff_unit->setFixedWidth(35);
     ptcutoff_unit->setFixedWidth(35);
+    upcutoff_unit->setFixedWidth(35);
     QHBoxLayout *cutoff_layout = new QHBoxLayout;
     cutoff_layout->addWidget(new QLabel("Cutoff:"));
     cutoff_layout->addStretch();
@@ -45,10 +49,16 @@ McLeodParametersWidget::McLeodParametersWidget(QWidget *parent/*=nullptr*/): QGr
     ptcutoff_layout->addStretch();
     ptcutoff_layout->addWidget(this->lower_pitch_cutoff);
     ptcutoff_layout->addWidget(ptcutoff_unit);
+    QHBoxLayout *upcutoff_layout = new QHBoxLayout;
+    upcutoff_layout->addWidget(new QLabel("Maximum frequency (0: none):"));
+    upcutoff_layout->addStretch();
+    upcutoff_layout->addWidget(this->upper_pitch_cutoff);
+    upcutoff_layout->addWidget(upcutoff_unit);
     QVBoxLayout *main_layout = new QVBoxLayout(this);
     main_layout->addLayout(cutoff_layout);
     main_layout->addLayout(smcutoff_layout);
     main_layout->addLayout(ptcutoff_layout);
+    main_layout->addLayout(upcutoff_layout);
     /* Architecture (End) */
 
     /* Logic */
@@ -56,12 +66,14 @@ McLeodParametersWidget::McLeodParametersWidget(QWidget *parent/*=nullptr*/): QGr
     this->cutoff->setValidator(new QDoubleValidator(0.0, 1.0, 4));                  // [0, 1]
     this->small_cutoff->setValidator(new QDoubleValidator(0.0, 1.0, 4));            // [0, 1]
     this->lower_pitch_cutoff->setValidator(new QDoubleValidator(0.0, 10000.0, 4));  // Hertz
+    this->upper_pitch_cutoff->setValidator(new QDoubleValidator(0.0, 100000.0, 4)); // Hertz
     /* Logic (End) */
 
     /* Connexions */
     connect(this->cutoff, SIGNAL (textEdited(QString)), this, SLOT (checkParameters()));
     connect(this->small_cutoff, SIGNAL (textEdited(QString)), this, SLOT (checkParameters()));
     connect(this->lower_pitch_cutoff, SIGNAL (textEdited(QString)), this, SLOT (checkParameters()));
+    connect(this->upper_pitch_cutoff, SIGNAL (textEdited(QString)), this, SLOT (checkParameters()));
     /* Connexions (End) */
 }
 
@@ -85,15 +97,18 @@ void McLeodParametersWidget::setParameters(const McLeodParameters & parameters)
     this->cutoff->setText(loc->toString(parameters.cutoff));
     this->small_cutoff->setText(loc->toString(parameters.small_cutoff));
     this->lower_pitch_cutoff->setText(loc->toString(parameters.lower_pitch_cutoff));
+    this->upper_pitch_cutoff->setText(loc->toString(parameters.upper_pitch_cutoff));
     this->checkParameters();
 }
 
 
 McLeodParameters McLeodParametersWidget::getParameters() {
-    McLeodParameters parameters;
+    // Parameters not exposed in the widget keep their default value
+    McLeodParameters parameters = DEFAULT_MC_LEOD_PARAMETERS;
     parameters.cutoff = this->cutoff->text().toDouble();
     parameters.small_cutoff = this->small_cutoff->text().toDouble();
     parameters.lower_pitch_cutoff = this->lower_pitch_cutoff->text().toDouble();
+    parameters.upper_pitch_cutoff = this->upper_pitch_cutoff->text().toDouble();
     return parameters;
 }
 
@@ -103,7 +118,8 @@ void McLeodParametersWidget::checkParameters() {
     QString text;
     std::vector<QLineEdit*> lines{  this->cutoff,
                                     this->small_cutoff,
-                                    this->lower_pitch_cutoff};
+                                    this->lower_pitch_cutoff,
+                                    this->upper_pitch_cutoff};
 
     for(auto const & line: lines) {
         text = line->text();
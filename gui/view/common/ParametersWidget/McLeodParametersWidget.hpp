@@ -20,6 +20,7 @@ private:
     QLineEdit *cutoff;
     QLineEdit *small_cutoff;
     QLineEdit *lower_pitch_cutoff;
+    QLineEdit *upper_pitch_cutoff;
     bool ready;
 private slots:
     void checkParameters();
@@ -0,0 +1,51 @@
+#ifndef AUDIO_INPUT
+#define AUDIO_INPUT
+
+#include <cstdint>
+#include <istream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+// Bytes read by chunk from a stream
+const size_t AUDIO_INPUT_CHUNK_SIZE = 64 * 1024;
+
+
+// Content of a multimedia file given without a file on the disk: a buffer of the caller, or a
+// stream read on demand (stdin, pipe). Every byte read from a stream is kept in memory, so the
+// readers of the input (and their clones) can go back in it even though the stream is not seekable:
+// once a stream has been decoded to its end (e.g. "-i -"), the whole encoded file is held in memory.
+// A stream is read forward only as far as the readers need: the FFmpeg readers see it as not
+// seekable and do not get its size, so probing does not read it until its end (unless the number
+// of samples is missing from the metadata and the stream has to be decoded to count them).
+// The input is shared by the readers: read() can be called from several threads.
+class AudioInput {
+public:
+    // Buffer of the caller (not copied: it must outlive the readers of the input)
+    AudioInput(const uint8_t * data, size_t size, std::string name="memory");
+    // Stream read until its end when needed (it must outlive the readers of the input)
+    AudioInput(std::istream & stream, std::string name="pipe");
+    std::string getName() const;
+    // Stream input (not seekable, size unknown until its end)
+    bool isStream() const;
+    // Copy up to size bytes from position, returns the number of bytes copied (0 at the end of the input)
+    size_t read(uint64_t position, uint8_t * buffer, size_t size);
+    // Size of the input in bytes (-1 while the end of the stream has not been reached)
+    int64_t getSize() const;
+    // Read the stream until its end, returns the size of the input
+    int64_t readAll();
+private:
+    // Read chunks of the stream until size bytes are available or until its end (mutex locked)
+    void readStream(uint64_t size);
+    std::string name;
+    const uint8_t * data;
+    size_t data_size;
+    std::istream * stream;
+    bool stream_finished;
+    // Bytes read from the stream
+    std::vector<uint8_t> stream_data;
+    mutable std::mutex stream_mutex;
+};
+
+#endif /* AUDIO_INPUT */
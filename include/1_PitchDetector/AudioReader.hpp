@@ -4,6 +4,7 @@
 #include <string>
 #include <iostream>
 #include <vector>
+#include <memory>
 #include "PitchExtractorMethod.hpp"
 
 
@@ -19,13 +20,37 @@ struct AudioStream {
 };
 
 
+// Type of the samples of the extracted buffers: FLOAT halves the memory traffic
+// and doubles the SIMD width of the analysis (fast mode)
+enum class SampleFormat {DOUBLE, FLOAT};
+
+
+// Buffer given in place by the reader (valid until the next call to the reader)
+template<typename T>
+struct BufferView {
+    const T * samples;
+    size_t size;
+};
+
+
 // Parameters needed to prepare extraction of audio buffers
+// resample_rate_hz: rate of the extracted buffers, SAME_SAMPLE_RATE (sample rate of the stream) or
+// AUTO_SAMPLE_RATE (lowest standard rate covering max_frequency_hz, the resampler low-pass filters the signal)
 struct AudioReaderParameters {
     double windowstimesize_s;
     double period_s;
     int64_t resample_rate_hz;
+    SampleFormat sample_format;
+    double max_frequency_hz;
 };
-const AudioReaderParameters DEFAULT_AUDIO_READER_PARAMETERS = {20e-3, 1e-3, -1};
+const int64_t SAME_SAMPLE_RATE = -1;
+const int64_t AUTO_SAMPLE_RATE = -2;
+const AudioReaderParameters DEFAULT_AUDIO_READER_PARAMETERS = {20e-3, 1e-3, SAME_SAMPLE_RATE, SampleFormat::DOUBLE, 4200.0};
+
+// Standard sample rates selected by AUTO_SAMPLE_RATE and part of the band below the Nyquist
+// frequency kept by the anti-aliasing filter
+const std::vector<int64_t> AUTO_SAMPLE_RATES_HZ = {8000, 11025, 16000, 22050, 32000, 44100, 48000};
+const double AUTO_SAMPLE_RATE_PASSBAND = 0.8;
 
 
 class AudioReader {
@@ -38,21 +63,48 @@ public:
     double getOuputPeriod() const;
     int64_t getOutputSampleRate() const;
     double getOutputWindowSize() const;
+    SampleFormat getOutputSampleFormat() const;
+    // Number of buffers expected from the extraction of a stream (computed from the number of samples
+    // of the stream and the time range, initExtraction() must be called before calling this function)
+    uint64_t getExpectedNumberOfBuffers(unsigned int audio_stream_ind=0) const;
     // Set parameters for buffer extraction 
     virtual void initExtraction(const AudioReaderParameters & parameters=DEFAULT_AUDIO_READER_PARAMETERS,
                                 unsigned int audio_stream_ind=0,
                                 double timestart_s=-1.0,
                                 double timestop_s=-1.0) = 0;
+    // Only extract the windows [first_window, first_window + nb_windows) of the extraction (nb_windows < 0:
+    // until the end), the first buffer is the window first_window: must be called after initExtraction()
+    // and before the first buffer (throws if the reader does not support it)
+    virtual void selectWindows(uint64_t first_window, int64_t nb_windows=-1);
+    // New reader of the same file with its own extraction (nullptr if the reader does not support it)
+    virtual std::unique_ptr<AudioReader> clone() const;
     // Get the next buffer of audio: initExtraction() must be called before calling this function
+    // (the type of the buffer must match the sample format given to initExtraction())
     virtual bool getNextBuffer(std::vector<double> & buffer) = 0;
+    virtual bool getNextBuffer(std::vector<float> & buffer) = 0;
+    // Same as getNextBuffer() without copy if the reader supports it
+    virtual bool getNextBufferView(BufferView<double> & view);
+    virtual bool getNextBufferView(BufferView<float> & view);
     void showStreamsInfos(std::ostream & stream_out) const;
 protected:
-    // Path of the multimedia file
+    // check_file = false: the input is not a file (stdin, memory), the name is given instead of the path
+    AudioReader(std::string name, bool check_file);
+    // Sample rate of the extraction of a stream (resolves SAME_SAMPLE_RATE and AUTO_SAMPLE_RATE)
+    int64_t getExtractionSampleRate(const AudioReaderParameters & parameters, unsigned int audio_stream_ind) const;
+    // Path of the multimedia file (name of the input if it is not a file)
     std::string filepath;
     std::vector<AudioStream> streams;
     double dst_period_s;
     int64_t dst_rate_hz;
     double dst_windowsize_s;
+    SampleFormat dst_sample_format;
+    // Time range of the extraction (negative: beginning / end of the stream)
+    double dst_timestart_s;
+    double dst_timestop_s;
+private:
+    // Buffers of the default getNextBufferView()
+    std::vector<double> view_buffer;
+    std::vector<float> view_buffer_float;
 };
 
 #endif /* AUDIO_READER */
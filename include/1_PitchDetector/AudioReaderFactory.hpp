@@ -0,0 +1,18 @@
+#ifndef AUDIO_READER_FACTORY
+#define AUDIO_READER_FACTORY
+
+#include <string>
+#include <memory>
+#include "AudioReader.hpp"
+#include "AudioInput.hpp"
+
+
+// Reader of a multimedia file: the WAV files supported by WavAudioReader are mapped
+// in memory, the other files are decoded by FFmpegAudioReader
+std::unique_ptr<AudioReader> create_audio_reader(const std::string & filepath);
+
+
+// Reader of an input in memory or of a stream (decoded by FFmpegAudioReader)
+std::unique_ptr<AudioReader> create_audio_reader(std::shared_ptr<AudioInput> input);
+
+#endif /* AUDIO_READER_FACTORY */
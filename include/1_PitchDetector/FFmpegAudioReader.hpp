@@ -2,21 +2,40 @@
 #define FFMPEG_AUDIO_READER
 
 #include <string>
+#include <memory>
 extern "C" {
     #include <libavformat/avformat.h>
     #include <libswresample/swresample.h>
     #include <libavutil/audio_fifo.h>
 }
 #include "AudioReader.hpp"
+#include "AudioInput.hpp"
 
 
 void init_packet(AVPacket *packet);
 
+// Decoding started before the first sample of an extraction (warm-up of the resampler filter), and
+// earlier for the codecs whose frames depend on the previous ones (warm-up of the decoder: overlap
+// of the transforms, bit reservoir...)
+const double FFMPEG_AUDIO_READER_PREROLL_S = 100e-3;
+const double FFMPEG_AUDIO_READER_DECODER_PREROLL_S = 400e-3;
+
+// Size of the buffer of the I/O context reading an AudioInput
+const int FFMPEG_AUDIO_READER_IO_BUFFER_SIZE = 32 * 1024;
+
+
+// Stream information at the opening of the file:
+// FAST: number of samples and duration from the metadata (the stream is decoded only if they are unknown)
+// EXACT: the streams are decoded to count their samples
+enum class ProbeMode {FAST, EXACT};
+
 
 class FFmpegAudioReader: public AudioReader {
 public:
     // Constructors & Destructor
-    FFmpegAudioReader(std::string filepath);
+    FFmpegAudioReader(std::string filepath, ProbeMode probe_mode=ProbeMode::FAST);
+    // Reader of an input in memory or of a stream (read through a custom I/O context, no file)
+    FFmpegAudioReader(std::shared_ptr<AudioInput> input, ProbeMode probe_mode=ProbeMode::FAST);
     ~FFmpegAudioReader();
     // Set parameters for buffer extraction 
     void initExtraction(const AudioReaderParameters & parameters=DEFAULT_AUDIO_READER_PARAMETERS,
@@ -25,48 +44,102 @@ public:
                         double timestop_s=-1.0);
     // Get the next buffer of audio: initExtraction() must be called before calling this function
     bool getNextBuffer(std::vector<double> & buffer);
+    bool getNextBuffer(std::vector<float> & buffer);
+    bool getNextBufferView(BufferView<double> & view);
+    bool getNextBufferView(BufferView<float> & view);
+    void selectWindows(uint64_t first_window, int64_t nb_windows=-1);
+    std::unique_ptr<AudioReader> clone() const;
+    // Number of (re)allocations of the buffers of the reader in the current extraction (converted
+    // samples, FIFO, packet structure and windows): they only happen for the first frames. The
+    // payloads of the packets and the frames of the decoder are allocated by FFmpeg (buffer pools
+    // of the demuxer and of the decoder) and are not counted.
+    uint64_t getNumberOfAllocations() const;
+    // Number of frames decoded by the current extraction (including the preroll after a seek)
+    uint64_t getNumberOfDecodedFrames() const;
 private:
+    FFmpegAudioReader(const FFmpegAudioReader & other);
+    void Init(ProbeMode probe_mode);
+    void InitMembers();
+    template<typename T>
+    bool extractNextBuffer(BufferView<T> & view, std::vector<T> & temp_buffer);
     // Functions
     void FreeConvertedSamples();
+    void FreePacket();
     void FreeInputFrame();
-    void FreeOutputFrame();
     void FreeCodecCtx();
     void FreeFormatCtx();
+    void FreeIOCtx();
     void FreeSwrCtx();
     void FreeAudioFifo();
-    void ConvertInputFrame();
+    void ConvertInputFrame(const uint8_t **input_samples, int nb_input_samples);
     void InitConvertedSamples();
     void AddSamplesToFifo();
-    void GetNbSamplesOut();
+    void GetNbSamplesOut(int nb_input_samples);
     void ConvertAndStoreOneFrame();
-    void InitOutputFrame();
     void InitAudioFifo();
     void InitSwrCtx();
     void InitInputFrame();
     void DecodeOneAudioFrame();
+    void SelectStream(int ind_stream);
     unsigned long int ExtractNumberOfSample();
     void GetCodecCtx(int indice_stream);
     std::vector<unsigned int> ExtractAudioStreamsIndex();
     void GetFormatCtxAndStreamInfo();
+    void InitIOCtx();
+    // Callbacks of the I/O context (opaque: the reader)
+    static int ReadInput(void *opaque, uint8_t *buf, int buf_size);
+    static int64_t SeekInput(void *opaque, int64_t offset, int whence);
+    void RewindFormatCtx();
     void updateIndexNextIteration();
+    void SeekToFirstSample();
+    bool AlignFirstFrameAfterSeek();
+    void SkipSamplesBeforeFirstSample();
     // Private attributes
+    // Input which is not a file (nullptr: the file is opened by FFmpeg) and position of the reader in it
+    std::shared_ptr<AudioInput> input;
+    AVIOContext *pIOCtx;
+    int64_t input_position;
     AVFormatContext *pFormatCtx;
+    // Packets have already been read from the format context (rewind before reusing it)
+    bool format_ctx_read;
     AVCodecContext *pCodecCtx;
     AVFrame *pInputFrame;
     bool data_present;
     bool finished;
     SwrContext *pSwrCtx;
     AVAudioFifo *pAudioFifo;
-    AVFrame *pOutputFrame;
     uint8_t **ppConvertedInputSamples;
+    int64_t nb_converted_samples_capacity;
+    AVPacket *pPacket;
+    int64_t fifo_capacity;
+    uint64_t nb_allocations;
+    uint64_t nb_decoded_frames;
     int64_t nb_samples_out;
     int64_t iteration;
     int64_t temp_buffer_start;
     int64_t temp_buffer_stop;
+    // Decoded samples from temp_buffer_start to temp_buffer_stop, the windows are views on them
     std::vector<double> temp_buffer;
+    std::vector<float> temp_buffer_float;
     int64_t ind_start;
     int64_t ind_stop;
     int64_t WS_resampled;
+    // Time range and selected windows: the samples decoded before the first sample are dropped after
+    // resampling, the extraction stops at the last window ending before the last sample
+    // (indices of output samples from the beginning of the stream)
+    int ind_stream_extraction;
+    bool seek_pending;
+    int64_t nb_samples_to_skip;
+    // Input samples of the first frame after a seek not given to the resampler (phase of the
+    // resampler), kept planes of the frame and warm-up of the decoder after a seek
+    int64_t nb_input_samples_to_drop;
+    std::vector<const uint8_t*> input_planes;
+    double decoder_preroll_s;
+    int64_t ind_first_sample;
+    int64_t ind_last_sample;
+    uint64_t first_window;
+    int64_t window_offset;
+    int64_t nb_windows_max;
 };
 
 #endif /* FFMPEG_AUDIO_READER */
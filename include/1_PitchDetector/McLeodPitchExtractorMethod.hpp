@@ -2,15 +2,66 @@
 #define MC_LEOD_PITCH_EXTRACTOR_METHOD
 
 #include "PitchExtractorMethod.hpp"
+#include "common_tools.hpp"
 #include <vector>
+#include <complex>
+#include <memory>
+#include <mutex>
 
 
+// Computation of the normalized square difference function (NSDF)
+// DIRECT: O(N^2) summation over every lag
+// FFT: O(N log N) autocorrelation via zero-padded real FFT, the NSDF values
+//      match the DIRECT method within 1e-10 (NSDF is normalized to 1 at lag 0)
+// INCREMENTAL: batches of windows (get_pitches), the lag products are updated with the
+//      samples entering and leaving the window, O(N x hop) per window. The NSDF values
+//      match the DIRECT method within 1e-7. Single windows (get_pitch) use the FFT.
+enum class NsdfMethod {DIRECT, FFT, INCREMENTAL};
+
+// Number of incremental updates before the lag products are computed again from scratch
+const uint64_t MC_LEOD_STREAM_REFRESH_PERIOD = 1000;
+// Energy ratio (current window / loudest window) below which the lag products are computed again
+const double MC_LEOD_STREAM_PRECISION_RATIO = 1e-6;
+
+
+// Pitches outside of ]lower_pitch_cutoff, upper_pitch_cutoff[ are rejected (every lag is still computed:
+// the threshold of the peaks depends on all of them), upper_pitch_cutoff <= 0 means no upper limit [Hz]
 struct McLeodParameters {
     double cutoff;
     double small_cutoff;
     double lower_pitch_cutoff;
+    double upper_pitch_cutoff;
+    NsdfMethod nsdf_method;
+};
+const McLeodParameters DEFAULT_MC_LEOD_PARAMETERS = {0.97, 0.5, 50.0, 0.0, NsdfMethod::FFT};
+
+
+// Sliding state: previous window and its lag products sum(x[i]x[i+tau])
+struct McLeodStreamState {
+    std::vector<double> buffer;
+    std::vector<double> acf;
+    uint64_t nb_updates;
+    double max_energy;
+};
+
+
+// Scratch buffers of the extraction, filled in place from one window to the next so that
+// the steady-state extraction does not allocate. A workspace must be used by one thread at a
+// time: the methods without workspace argument use a workspace owned by the calling thread.
+struct McLeodWorkspace {
+    std::vector<double> signal;
+    std::vector<float> signal_float;
+    std::vector<std::complex<double>> spectrum;
+    std::vector<double> nsdf;
+    std::vector<double> prefix_sum;
+    std::vector<unsigned int> max_positions;
+    std::vector<double> period_estimates;
+    std::vector<double> amp_estimates;
+    // FFT of the last buffer size (avoids locking the shared one)
+    std::shared_ptr<const RealFFT> fft;
+    // Lag products of the last window of the batches (NsdfMethod::INCREMENTAL)
+    McLeodStreamState stream;
 };
-const McLeodParameters DEFAULT_MC_LEOD_PARAMETERS = {0.97, 0.5, 50.0};
 
 
 class McLeodPitchExtractorMethod: public PitchExtractorMethod {
@@ -23,19 +74,58 @@ public:
     void setCutoff(double cutoff);
     void setSmallCutoff(double small_cutoff);
     void setLowerPitch(double lower_pitch_cutoff);
+    void setUpperPitch(double upper_pitch_cutoff);
+    void setNsdfMethod(NsdfMethod nsdf_method);
     double getCutoff() const;
     double getSmallCutoff() const;
     double getLowerPitch() const;
+    double getUpperPitch() const;
+    NsdfMethod getNsdfMethod() const;
     // Perform pitch detection on input buffer
+    // (single precision buffers: the lag products are computed in float, the FFT in double)
     double get_pitch(const std::vector<double> & audio_buffer, double sample_rate_hz) const;
+    double get_pitch(const std::vector<float> & audio_buffer, double sample_rate_hz) const;
+    double get_pitch(const std::vector<double> & audio_buffer, double sample_rate_hz, McLeodWorkspace & workspace) const;
+    double get_pitch(const std::vector<float> & audio_buffer, double sample_rate_hz, McLeodWorkspace & workspace) const;
+    // NSDF of the lags computed by get_pitch() (one value per lag, 1 at lag 0)
+    void get_nsdf(const std::vector<double> & audio_buffer, std::vector<double> & nsdf) const;
+    // Batch of windows: the INCREMENTAL method slides from one window of the batch to the next.
+    // The lag products are kept in the workspace from one batch to the next: a batch following
+    // the previous one of the workspace (same hop, overlapping samples) continues to slide,
+    // otherwise it starts from an exact computation.
+    void get_pitches(const WindowBatch<double> & batch, double sample_rate_hz, double * pitches_hz, double * energies) const;
+    void get_pitches(const WindowBatch<float> & batch, double sample_rate_hz, double * pitches_hz, double * energies) const;
+    void get_pitches(const WindowBatch<double> & batch, double sample_rate_hz, double * pitches_hz, double * energies, McLeodWorkspace & workspace) const;
+    void get_pitches(const WindowBatch<float> & batch, double sample_rate_hz, double * pitches_hz, double * energies, McLeodWorkspace & workspace) const;
 private:
-    void normalizedSquareDifference(const std::vector<double> & audio_buffer, std::vector<double> & nsdf) const;
+    template<typename T>
+    void computeNsdf(const T * audio_buffer, size_t buffer_size, McLeodWorkspace & workspace) const;
+    template<typename T>
+    double getPitch(const T * audio_buffer, size_t buffer_size, double sample_rate_hz, McLeodWorkspace & workspace) const;
+    template<typename T>
+    void getPitches(const WindowBatch<T> & batch, double sample_rate_hz, double * pitches_hz, double * energies, McLeodWorkspace & workspace) const;
+    double pitchFromNsdf(const std::vector<double> & nsdf, size_t buffer_size, double sample_rate_hz, McLeodWorkspace & workspace) const;
+    template<typename T>
+    void normalizedSquareDifference(const T * audio_buffer, size_t buffer_size, McLeodWorkspace & workspace) const;
+    template<typename T>
+    void normalizedSquareDifferenceFFT(const T * audio_buffer, size_t buffer_size, McLeodWorkspace & workspace) const;
+    template<typename T>
+    void normalizedSquareDifferenceIncremental(const T * audio_buffer, size_t buffer_size, size_t hop_size,
+                                               McLeodStreamState & stream, McLeodWorkspace & workspace) const;
+    void autocorrelationFFT(const std::vector<double> & signal, std::vector<double> & acf, McLeodWorkspace & workspace) const;
+    std::shared_ptr<const RealFFT> getFFT(uint64_t size) const;
+    const RealFFT & getFFT(uint64_t size, McLeodWorkspace & workspace) const;
     void parabolicInterpolation(unsigned int tau, const std::vector<double> & nsdf, double & turningpoint_x, double & turningpoint_y) const;
-    void peakPicking(const std::vector<double> & nsdf, std::vector<unsigned int> & max_positions) const;
+    void peakPicking(const std::vector<double> & nsdf, size_t buffer_size, std::vector<unsigned int> & max_positions) const;
     // Mc Leod Parameters
     double cutoff;
     double small_cutoff;
     double lower_pitch_cutoff;
+    double upper_pitch_cutoff;
+    NsdfMethod nsdf_method;
+    // FFT shared by the threads calling get_pitch(), rebuilt when the buffer size changes
+    mutable std::shared_ptr<const RealFFT> fft;
+    mutable std::mutex fft_mutex;
 };
 
 #endif /* MC_LEOD_PITCH_EXTRACTOR_METHOD */
@@ -4,9 +4,12 @@
 #include <thread>
 #include <future>
 #include <atomic>
+#include <memory>
 #include "AudioReader.hpp"
 #include "PitchExtractorMethod.hpp"
 #include "common_tools.hpp"
+#include "ThreadPool.hpp"
+#include "BoundedQueue.hpp"
 
 
 struct PitchResult {
@@ -18,6 +21,23 @@ struct PitchResult {
 };
 
 const unsigned int CONCURRENT_THREADS_SUPPORTED = std::thread::hardware_concurrency();
+// Number of windows given at once to the pitch extractor
+const size_t PITCH_DETECTOR_BATCH_SIZE = 256;
+// Number of batches waiting for a worker (per worker thread), the reading of
+// the audio is paused while the queue is full
+const size_t PITCH_DETECTOR_QUEUED_BATCHES_PER_THREAD = 1;
+// Number of batches decoded ahead of the workers, the decoding thread is
+// paused while they are all waiting
+const size_t PITCH_DETECTOR_DECODED_BATCHES = 4;
+
+// Contiguous samples of consecutive windows, produced by the decoding thread
+template<typename T>
+struct PitchBatch {
+    uint64_t first_window;
+    size_t nb_windows;
+    size_t window_size;
+    std::vector<T> samples;
+};
 
 class PitchDetector {
 public:
@@ -33,14 +53,37 @@ public:
                         double timestop_s=-1.0);
     void setFO(double f0_hz);
     double getFO();
+    // Number of worker threads (0: one per hardware thread)
+    void setNumberOfThreads(unsigned int nb_threads);
+    unsigned int getNumberOfThreads() const;
+    // Number of time segments of the stream decoded concurrently, each one by its own
+    // reader (1: a single reader, also used if the reader cannot be cloned)
+    void setNumberOfSegments(unsigned int nb_segments);
+    unsigned int getNumberOfSegments() const;
 private:
     PitchResult tempresult;
+    unsigned int nb_threads;
+    unsigned int nb_segments;
+    // Workers kept from one perform() to the next
+    std::unique_ptr<ThreadPool> thread_pool;
+    ThreadPool & getThreadPool();
     double f0_hz;
     AudioReader *audio_reader;
     PitchExtractorMethod *pitch_extractor;
-    // Calculate the normalized energy of an audio buffer
-    void processBuffer(size_t index, double sample_rate_hz, const std::vector<double> buffer);
-    double getEnergy(const std::vector<double> & audio_buffer) const;
+    // Pipeline: decoding threads (one per reader) read the buffers and merge them into batches, the workers
+    // compute the pitches of the batches and the calling thread assembles the results in order
+    // (T being the sample type of the audio reader output, first_windows: first window of each reader)
+    template<typename T>
+    void processBuffers(std::atomic<float> * progress, const AudioReaderParameters & audio_parameters,
+                        const std::vector<AudioReader*> & readers, const std::vector<uint64_t> & first_windows,
+                        uint64_t nb_buffers, double sample_rate_hz, double duration_s);
+    // Decoding thread: read the buffers of an audio reader and queue the batches
+    template<typename T>
+    void decodeBatches(AudioReader & reader, double hop_size, uint64_t first_window, BoundedQueue<PitchBatch<T>> & batches);
+    // Pitch [st] and energy of a batch of consecutive windows, written in the slots of the batch in the output arrays
+    template<typename T>
+    void processBatch(const PitchBatch<T> & batch, double hop_size, double sample_rate_hz,
+                      double * pitches_st, double * energies) const;
 };
 
 #endif /* PITCH_DETECTOR */
@@ -3,6 +3,30 @@
 
 #include <string>
 #include <vector>
+#include <cstdint>
+#include "common_tools.hpp"
+
+
+// Overlapping windows of a contiguous block of samples: the window k (k < nb_windows)
+// starts at samples + getWindowStart(k). The hop can be fractional, the windows are
+// positioned as the window first_window + k of the stream (see get_window_start()).
+template<typename T>
+struct WindowBatch {
+    const T * samples;
+    size_t window_size;
+    double hop_size;
+    uint64_t first_window;
+    size_t nb_windows;
+    // Offset of the window k from the base pointer
+    size_t getWindowStart(size_t k) const {
+        return (size_t)(get_window_start(this->hop_size, this->first_window + k) - get_window_start(this->hop_size, this->first_window));
+    }
+    // Number of samples needed from the base pointer
+    size_t getNumberOfSamples() const {
+        return (this->nb_windows == 0) ? 0 : this->getWindowStart(this->nb_windows - 1) + this->window_size;
+    }
+};
+
 
 class PitchExtractorMethod {
 public:
@@ -11,6 +35,16 @@ public:
     virtual ~PitchExtractorMethod();
     // Get pitch from the input buffer
     virtual double get_pitch(const std::vector<double> & audio_buffer, double sample_rate_hz) const = 0;
+    // Single precision buffers (converted to double unless the method has a float implementation)
+    virtual double get_pitch(const std::vector<float> & audio_buffer, double sample_rate_hz) const;
+    // Get the pitch [Hz] and the normalized energy of every window of the batch
+    // (the output arrays must hold batch.nb_windows values). The default implementation
+    // calls get_pitch() for each window.
+    virtual void get_pitches(const WindowBatch<double> & batch, double sample_rate_hz, double * pitches_hz, double * energies) const;
+    virtual void get_pitches(const WindowBatch<float> & batch, double sample_rate_hz, double * pitches_hz, double * energies) const;
+    // Normalized energy (mean of the squared samples) of a window
+    static double getEnergy(const double * audio_buffer, size_t size);
+    static double getEnergy(const float * audio_buffer, size_t size);
 };
 
 #endif /* PITCH_EXTRACTOR_METHOD */
@@ -0,0 +1,91 @@
+#ifndef WAV_AUDIO_READER
+#define WAV_AUDIO_READER
+
+#include <string>
+#include <memory>
+#include "AudioReader.hpp"
+
+
+// Encoding of the samples of a RIFF/WAVE file
+enum class WavSampleFormat {PCM16, PCM24, PCM32, FLOAT32, FLOAT64};
+
+
+// Resampling of the mapped samples (same defaults as the FFmpeg resampler): Kaiser windowed sinc
+// of WAV_RESAMPLING_FILTER_SIZE periods of the lowest rate, cut at WAV_RESAMPLING_CUTOFF times its
+// Nyquist frequency. A rate ratio needing more than WAV_RESAMPLING_MAX_PHASES filter phases is
+// resampled by FFmpeg.
+const double WAV_RESAMPLING_CUTOFF = 0.97;
+const int64_t WAV_RESAMPLING_FILTER_SIZE = 32;
+const double WAV_RESAMPLING_KAISER_BETA = 9.0;
+const int64_t WAV_RESAMPLING_MAX_PHASES = 1024;
+
+
+// File mapped in memory (shared by the clones of a reader)
+class MappedFile;
+
+
+// Reader of PCM and floating point WAV files: the file is mapped in memory and the windows are
+// read, downmixed and resampled directly from the mapped pages (no decoder).
+class WavAudioReader: public AudioReader {
+public:
+    // Constructors & Destructor (throws if the file is not a supported WAV file)
+    WavAudioReader(std::string filepath);
+    ~WavAudioReader();
+    // Set parameters for buffer extraction
+    void initExtraction(const AudioReaderParameters & parameters=DEFAULT_AUDIO_READER_PARAMETERS,
+                        unsigned int audio_stream_ind=0,
+                        double timestart_s=-1.0,
+                        double timestop_s=-1.0);
+    // Get the next buffer of audio: initExtraction() must be called before calling this function
+    bool getNextBuffer(std::vector<double> & buffer);
+    bool getNextBuffer(std::vector<float> & buffer);
+    bool getNextBufferView(BufferView<double> & view);
+    bool getNextBufferView(BufferView<float> & view);
+    void selectWindows(uint64_t first_window, int64_t nb_windows=-1);
+    std::unique_ptr<AudioReader> clone() const;
+    WavSampleFormat getWavSampleFormat() const;
+private:
+    WavAudioReader(const WavAudioReader & other);
+    void parseHeader();
+    // Mono samples of the frames [first_frame, first_frame + nb_frames) (mean of the channels)
+    template<typename T>
+    void convertFrames(int64_t first_frame, int64_t nb_frames, T * samples) const;
+    // Mono samples [first_sample, first_sample + nb_samples) at the rate of the extraction
+    template<typename T>
+    void convertSamples(int64_t first_sample, int64_t nb_samples, T * samples);
+    void initResampling(int64_t src_rate_hz, int64_t dst_rate_hz);
+    template<typename T>
+    bool extractNextBuffer(BufferView<T> & view, std::vector<T> & temp_buffer);
+    std::shared_ptr<const MappedFile> mapped_file;
+    // Data chunk
+    size_t data_offset;
+    int64_t nb_frames;
+    unsigned int nb_channels;
+    size_t bytes_per_sample;
+    WavSampleFormat wav_sample_format;
+    // Resampling by a polyphase filter: the sample n of the extraction is at the frame
+    // n * down_factor / up_factor, the phase p has the 2 * filter_half_size taps of the frames
+    // around the position p / up_factor
+    int64_t up_factor;
+    int64_t down_factor;
+    int64_t filter_half_size;
+    std::vector<double> filter;
+    std::vector<double> resampling_input;
+    // Resampling by FFmpeg (rate ratio with too many phases), built once
+    std::unique_ptr<AudioReader> resampling_reader;
+    bool use_resampling_reader;
+    // Extraction (indices of frames of the file)
+    int64_t WS;
+    int64_t iteration;
+    int64_t ind_first_sample;
+    int64_t ind_last_sample;
+    uint64_t first_window;
+    int64_t window_offset;
+    int64_t nb_windows_max;
+    // Converted samples from temp_buffer_start, the windows are views on them
+    int64_t temp_buffer_start;
+    std::vector<double> temp_buffer;
+    std::vector<float> temp_buffer_float;
+};
+
+#endif /* WAV_AUDIO_READER */
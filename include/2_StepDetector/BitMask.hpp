@@ -0,0 +1,46 @@
+#ifndef BIT_MASK
+#define BIT_MASK
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+
+// Mask of samples packed in 64-bit words: the logical operations combine 64 samples at once
+// and the runs of samples are found word by word (count trailing zeros).
+// The bits after the last sample of the last word are always 0.
+class BitMask {
+public:
+    // Constructors
+    BitMask(size_t size=0, bool value=false);
+    BitMask(const std::vector<bool> & values);
+    size_t size() const;
+    bool empty() const;
+    bool get(size_t index) const;
+    void set(size_t index, bool value);
+    void assign(size_t size, bool value);
+    std::vector<bool> toVector() const;
+    // Number of samples set to true
+    size_t count() const;
+    // In place logical operations (throws if the sizes are not equal)
+    BitMask & operator|=(const BitMask & other);
+    BitMask & operator&=(const BitMask & other);
+    void flip();
+    BitMask operator|(const BitMask & other) const;
+    BitMask operator&(const BitMask & other) const;
+    BitMask operator~() const;
+    bool operator==(const BitMask & other) const;
+    bool operator!=(const BitMask & other) const;
+    // Index of the first sample equal to value from index (size() if there is none)
+    size_t findNext(size_t index, bool value) const;
+    // Runs [first, second) of consecutive samples equal to value, of at least min_length samples
+    std::vector<std::pair<uint64_t, uint64_t>> getRuns(bool value, uint64_t min_length=0) const;
+private:
+    void checkSize(const BitMask & other) const;
+    void clearPadding();
+    std::vector<uint64_t> words;
+    size_t nb_bits;
+};
+
+#endif /* BIT_MASK */
@@ -21,8 +21,8 @@ public:
     // Method to override performing the steps recovering
     std::vector<std::pair<uint64_t, double>> recoverSteps(const std::vector<double> & pitch_buffer, const StepParameters & parameters=DEFAULT_STEP_PARAMETERS);
 private:
-    Histogram getHistogram(const std::vector<double> & pitch_buffer) const;
-    void smoothHistogram(Histogram & histo) const;
+    void getHistogram(const std::vector<double> & pitch_buffer, Histogram & histo) const;
+    void smoothHistogram(Histogram & histo);
     void detectPitchs(const std::vector<uint64_t> & indexes, const Histogram & histo);
     void deleteNotesTooShort(double min_note_length_s);
     void deleteNotesTooClose(double min_note_gap_st);
@@ -34,6 +34,9 @@ private:
     double histogram_step_st;
     double std_gaussian;
     std::vector<double> gaussian_shape;
+    // Reused from one group of notes to the next one
+    Histogram histogram_buffer;
+    std::vector<double> smoothing_buffer;
     std::vector<DetectedPitch> pitchs;
 };
 
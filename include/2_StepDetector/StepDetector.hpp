@@ -6,6 +6,7 @@
 #include <atomic>
 #include "PitchDetector.hpp"
 #include "common_tools.hpp"
+#include "BitMask.hpp"
 
 struct AnalogNote {
     bool is_a_note;
@@ -32,6 +33,15 @@ struct StepParameters {
 const StepParameters DEFAULT_STEP_PARAMETERS = {100e-3, 2/3.0, 20e-3, 0.0, 200.0};
 
 
+// Density of the energy (dB) used by maskAutoEnergy(): gaussian kde evaluated on AUTO_ENERGY_BINS bins, with the
+// smallest bandwidth AUTO_ENERGY_BANDWIDTH_MIN + k * AUTO_ENERGY_BANDWIDTH_STEP (k < AUTO_ENERGY_MAX_STEPS)
+// giving at most two maxima (noise and signal)
+const uint64_t AUTO_ENERGY_BINS = 1000;
+const double AUTO_ENERGY_BANDWIDTH_MIN = 0.1;
+const double AUTO_ENERGY_BANDWIDTH_STEP = 0.01;
+const uint64_t AUTO_ENERGY_MAX_STEPS = 1 << 16;
+
+
 class StepDetector {
 public:
     // Constructors & Destructor
@@ -59,14 +69,19 @@ public:
     void resetPitchMask();
     void resetEnergyMask();
     bool hasEnergy() const;
-    std::vector<bool> getCombinedMasks() const;
+    // Logical OR of the mask, of the pitch mask and of the energy mask
+    BitMask getCombinedMasks() const;
     double getMeanEnergy(size_t index_start, size_t index_stop) const;
     void maskThroughEnergyHysteresis(double threshold_off, double threshold_on);
     void maskThroughEnergyCumulativeSum(double threshold_min, double cumsum_min);
     void maskThroughToneHeight(double tone_min, double tone_max);
     void medianFilterPitch(double window_size_s);
     void medianFilterEnergy(double window_size_s);
-    void maskAutoEnergy();
+    // bandwidth > 0: bandwidth of a previous run (getAutoEnergyBandwidth()), used without search if it
+    // still gives two maxima
+    void maskAutoEnergy(double bandwidth=-1.0);
+    // Bandwidth chosen by the last call to maskAutoEnergy() (-1 before)
+    double getAutoEnergyBandwidth() const;
     StepResult extractNotesFromGroups(const StepParameters & parameters);
     virtual std::vector<std::pair<uint64_t, double>> recoverSteps(const std::vector<double> & pitch_buffer, const StepParameters & parameters) = 0;
 protected:
@@ -78,11 +93,12 @@ private:
     std::vector<double> pitch_st;
     double f0_hz;
     bool has_energy;
-    std::vector<bool> mask;
-    std::vector<bool> pitch_mask;
-    std::vector<bool> energy_mask;
+    BitMask mask;
+    BitMask pitch_mask;
+    BitMask energy_mask;
     std::vector<double> energy;
     std::vector<std::pair<uint64_t, uint64_t>> groups;
+    double auto_energy_bandwidth;
 };
 
 #endif /* STEP_DETECTOR */
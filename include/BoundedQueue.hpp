@@ -0,0 +1,107 @@
+#ifndef BOUNDED_QUEUE
+#define BOUNDED_QUEUE
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+
+// FIFO shared between producer and consumer threads: push() waits while the queue is full,
+// pop() waits while it is empty. Waiting threads sleep on a condition variable.
+// After close(), push() fails and pop() returns the remaining items then fails.
+template<typename T>
+class BoundedQueue {
+public:
+    // Constructor (capacity = 0: no limit)
+    BoundedQueue(size_t capacity=0);
+    // Add an item, returns false if the queue is closed
+    bool push(T item);
+    // Get the oldest item, returns false if the queue is closed and empty
+    bool pop(T & item);
+    // Wake up the waiting threads, no item can be added anymore
+    void close();
+    bool isClosed() const;
+    size_t size() const;
+    size_t getCapacity() const;
+private:
+    std::deque<T> items;
+    size_t capacity;
+    bool closed;
+    mutable std::mutex items_mutex;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+};
+
+
+template<typename T>
+BoundedQueue<T>::BoundedQueue(size_t capacity/*=0*/) {
+    // Constructor
+    this->capacity = capacity;
+    this->closed = false;
+}
+
+
+template<typename T>
+bool BoundedQueue<T>::push(T item) {
+    {
+        std::unique_lock<std::mutex> lock(this->items_mutex);
+        this->not_full.wait(lock, [this]() {
+            return this->closed || (this->capacity == 0) || (this->items.size() < this->capacity);
+        });
+        if(this->closed) {
+            return false;
+        }
+        this->items.push_back(std::move(item));
+    }
+    this->not_empty.notify_one();
+    return true;
+}
+
+
+template<typename T>
+bool BoundedQueue<T>::pop(T & item) {
+    {
+        std::unique_lock<std::mutex> lock(this->items_mutex);
+        this->not_empty.wait(lock, [this]() { return this->closed || !this->items.empty(); });
+        if(this->items.empty()) {
+            return false;
+        }
+        item = std::move(this->items.front());
+        this->items.pop_front();
+    }
+    this->not_full.notify_one();
+    return true;
+}
+
+
+template<typename T>
+void BoundedQueue<T>::close() {
+    {
+        std::lock_guard<std::mutex> lock(this->items_mutex);
+        this->closed = true;
+    }
+    this->not_empty.notify_all();
+    this->not_full.notify_all();
+}
+
+
+template<typename T>
+bool BoundedQueue<T>::isClosed() const {
+    std::lock_guard<std::mutex> lock(this->items_mutex);
+    return this->closed;
+}
+
+
+template<typename T>
+size_t BoundedQueue<T>::size() const {
+    std::lock_guard<std::mutex> lock(this->items_mutex);
+    return this->items.size();
+}
+
+
+template<typename T>
+size_t BoundedQueue<T>::getCapacity() const {
+    return this->capacity;
+}
+
+#endif /* BOUNDED_QUEUE */
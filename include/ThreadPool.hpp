@@ -0,0 +1,47 @@
+#ifndef THREAD_POOL
+#define THREAD_POOL
+
+#include <thread>
+#include <future>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <stdexcept>
+#include "BoundedQueue.hpp"
+
+
+// Fixed number of worker threads created once and fed with tasks,
+// the tasks are executed in the order of submission
+class ThreadPool {
+public:
+    // Constructor & Destructor (nb_threads = 0: one thread per hardware thread)
+    // With a queue capacity, submit() waits while the number of pending tasks is
+    // at the capacity (back-pressure on the producer, 0: no limit)
+    ThreadPool(unsigned int nb_threads=0, size_t queue_capacity=0);
+    // Waits for the tasks already submitted
+    ~ThreadPool();
+    unsigned int getNumberOfThreads() const;
+    size_t getQueueCapacity() const;
+    // Queue a task, the future gives its result (or rethrows its exception)
+    template<typename F>
+    std::future<typename std::result_of<F()>::type> submit(F task);
+private:
+    void workerLoop();
+    std::vector<std::thread> workers;
+    BoundedQueue<std::function<void()>> tasks;
+};
+
+
+template<typename F>
+std::future<typename std::result_of<F()>::type> ThreadPool::submit(F task) {
+    typedef typename std::result_of<F()>::type result_type;
+    // std::function needs a copyable callable
+    auto packaged = std::make_shared<std::packaged_task<result_type()>>(std::move(task));
+    std::future<result_type> result = packaged->get_future();
+    if(!this->tasks.push([packaged]() { (*packaged)(); })) {
+        throw std::runtime_error("Thread pool is stopping");
+    }
+    return result;
+}
+
+#endif /* THREAD_POOL */
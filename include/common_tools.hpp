@@ -7,6 +7,8 @@
 #include <algorithm>
 #include <cmath>
 #include <tuple>
+#include <complex>
+#include <memory>
 
 // Standard frequency for the equally tempered scale
 const double F0_HZ = 32.7032;
@@ -28,7 +30,8 @@ bool exists(const std::string & name);
 std::vector<bool> mask_logical_or(const std::vector<bool> & maskA, const std::vector<bool> & maskB);
 
 
-// Median filter
+// Median filter (NaN samples are ignored, the output is NaN if more than half of the window is NaN)
+// computed in O(N log(kernel_size)) by a sliding median
 std::vector<double> median_filter(const std::vector<double> & signal, uint64_t kernel_size);
 
 
@@ -36,17 +39,44 @@ std::vector<double> median_filter(const std::vector<double> & signal, uint64_t k
 double autocovariance(const std::vector<double> & data);
 
 
+// Evaluation of a Gaussian kde:
+// EXACT: sum of the kernels of all the samples at each point, O(n.m)
+// BINNED: the samples are linearly binned on the points, the bins are convolved by FFT with the kernel
+// truncated at KDE_BINNED_TRUNCATION standard deviations, O(n + m.log(m)). The points must be evenly
+// spaced (the exact evaluation is used otherwise). The error relative to the maximum of the density
+// is about (step of the points / standard deviation of the kernel)^2 / 8. The half size of the kernel is
+// limited to KDE_BINNED_MAX_KERNEL_RATIO times the number of points (FFT of a few times the number of
+// points), the exact evaluation is used for wider kernels.
+enum class KdeMethod {EXACT, BINNED};
+const double KDE_BINNED_TRUNCATION = 6.0;
+const double KDE_BINNED_MAX_KERNEL_RATIO = 4.0;
+
+
+class RealFFT;
+
+
 // Gaussian kde
 class GaussianKde {
 public:
     // Constructor
-    GaussianKde(const std::vector<double> & dataset, const std::string & bw_method="scott");
-    GaussianKde(const std::vector<double> & dataset, double bw_method);
+    GaussianKde(const std::vector<double> & dataset, const std::string & bw_method="scott", KdeMethod method=KdeMethod::EXACT);
+    GaussianKde(const std::vector<double> & dataset, double bw_method, KdeMethod method=KdeMethod::EXACT);
     // Destructor
     virtual ~GaussianKde();
     std::vector<double> evaluate(const std::vector<double> & points);
+    KdeMethod getMethod() const;
+    // Change the bandwidth factor: the covariance of the dataset and the bins of BINNED are reused
+    void setBandwidth(double bw_method);
+    double getBandwidth() const;
 private:
     void computeCovariance();
+    void updateBandwidth();
+    std::vector<double> evaluateExact(const std::vector<double> & points) const;
+    // Empty if the points are not evenly spaced
+    std::vector<double> evaluateBinned(const std::vector<double> & points);
+    // Bins of the samples on the points extended by extension bins on each side
+    void binSamples(const std::vector<double> & points, double step, uint64_t extension);
+    KdeMethod method;
     std::vector<double> dataset;
     uint64_t n;
     double factor;
@@ -55,6 +85,11 @@ private:
     double covariance;
     double inv_cov;
     double _norm_factor;
+    // Binned samples (BINNED), kept between evaluations on the same points
+    std::vector<double> binned_points;
+    uint64_t bins_extension;
+    std::shared_ptr<const RealFFT> bins_fft;
+    std::vector<std::complex<double>> bins_spectrum;
 };
 
 
@@ -69,8 +104,12 @@ struct Histogram {
 std::vector<double> get_histogram_points(const std::vector<double> & signal, uint64_t bins);
 
 
-// classic Histogram
+// classic Histogram: bins [x[k], x[k+1]) of equal width, the last one also counts the samples equal to range_max
 Histogram histogram(const std::vector<double> & signal, uint64_t bins, double range_min, double range_max);
+// Same in the vectors of result (no allocation when they are large enough),
+// accumulate: the counts are added to the ones of result (same number of bins)
+void histogram(const std::vector<double> & signal, uint64_t bins, double range_min, double range_max,
+               Histogram & result, bool accumulate=false);
 
 
 double convert_tone_to_freq(double tone_st, double f0_hz=F0_HZ);
@@ -82,6 +121,38 @@ double convert_freq_to_tone(double freq_hz, double f0_hz=F0_HZ);
 std::vector<double> gaussian(uint64_t nb_samples, double standard_deviation, bool density_function=false);
 
 
+// Smallest power of two greater than or equal to the input value
+uint64_t next_power_of_two(uint64_t value);
+
+
+// Index of the first sample of the window number 'index' of a stream,
+// hop_size being the (possibly fractional) number of samples between two windows
+int64_t get_window_start(double hop_size, uint64_t index);
+
+
+// Radix-2 FFT of real signals, the size must be a power of two (>= 2)
+// The twiddle factors are computed once at construction so an instance can be reused for every buffer
+class RealFFT {
+public:
+    // Constructor
+    RealFFT(uint64_t size);
+    // Destructor
+    virtual ~RealFFT();
+    uint64_t getSize() const;
+    // Spectrum (size/2 + 1 bins) of the input signal zero-padded to the FFT size
+    void forward(const std::vector<double> & signal, std::vector<std::complex<double>> & spectrum) const;
+    // Real signal (size samples) from its size/2 + 1 first bins, inverse of forward()
+    void inverse(const std::vector<std::complex<double>> & spectrum, std::vector<double> & signal) const;
+private:
+    // In-place complex FFT of size/2 points
+    void transform(std::complex<double> * data, bool inverse) const;
+    uint64_t size;
+    std::vector<uint64_t> bit_reversed;
+    std::vector<std::complex<double>> twiddles;
+    std::vector<std::complex<double>> real_twiddles;
+};
+
+
 // Template functions
 ///////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////
@@ -96,8 +167,9 @@ template<typename T>
 void erase_nan(std::vector<T> & signal);
 
 
+// Convolution in a buffer of the caller (its memory is reused)
 template<typename T>
-std::vector<T> convolve(const std::vector<T> & A, const std::vector<T> & B) {
+void convolve(const std::vector<T> & A, const std::vector<T> & B, std::vector<T> & result) {
     // Output is same size as A vector
     size_t ind_middle;
     if(A.size() == B.size()){
@@ -113,7 +185,7 @@ std::vector<T> convolve(const std::vector<T> & A, const std::vector<T> & B) {
             ind_middle = (B.size() - 1) / 2;
         }
     }
-    std::vector<T> result;
+    result.clear();
     T temp_value;
     size_t m_min;
     size_t m_max;
@@ -127,6 +199,13 @@ std::vector<T> convolve(const std::vector<T> & A, const std::vector<T> & B) {
         }
         result.push_back(temp_value);
     }
+}
+
+
+template<typename T>
+std::vector<T> convolve(const std::vector<T> & A, const std::vector<T> & B) {
+    std::vector<T> result;
+    convolve(A, B, result);
     return result;
 }
 
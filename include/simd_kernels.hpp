@@ -0,0 +1,51 @@
+#ifndef SIMD_KERNELS
+#define SIMD_KERNELS
+
+#include <cstddef>
+#include <string>
+
+// Vectorized primitives used by the pitch extraction, in double and single precision
+// (single precision results are accumulated in float lanes and returned as double).
+// The best instruction set supported by the CPU is selected at the first call (CPUID),
+// the library does not need to be rebuilt for each host.
+enum class InstructionSet {SCALAR, SSE2, AVX2, AVX512};
+
+
+// Check if the CPU (and the compiler) support an instruction set
+bool instruction_set_supported(InstructionSet instruction_set);
+
+
+// Instruction set currently used by the kernels
+InstructionSet get_instruction_set();
+
+
+// Force the instruction set used by the kernels (throws if not supported)
+void set_instruction_set(InstructionSet instruction_set);
+
+
+std::string enum_to_string(InstructionSet instruction_set);
+
+
+// Sum of the samples
+double kernel_sum(const double * x, size_t n);
+
+
+// Sum of x[i] * y[i]
+double kernel_dot(const double * x, const double * y, size_t n);
+
+
+// Sum of x[i] * x[i]
+double kernel_sum_squares(const double * x, size_t n);
+
+
+// y[i] = x[i] - value (x and y can be the same array)
+void kernel_subtract(const double * x, double value, double * y, size_t n);
+
+
+// Single precision
+double kernel_sum(const float * x, size_t n);
+double kernel_dot(const float * x, const float * y, size_t n);
+double kernel_sum_squares(const float * x, size_t n);
+void kernel_subtract(const float * x, float value, float * y, size_t n);
+
+#endif /* SIMD_KERNELS */
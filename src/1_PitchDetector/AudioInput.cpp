@@ -0,0 +1,87 @@
+#include "AudioInput.hpp"
+#include <algorithm>
+#include <cstring>
+
+
+AudioInput::AudioInput(const uint8_t * data, size_t size, std::string name/*="memory"*/) {
+    // Constructor
+    this->name = name;
+    this->data = data;
+    this->data_size = size;
+    this->stream = nullptr;
+    this->stream_finished = true;
+}
+
+
+AudioInput::AudioInput(std::istream & stream, std::string name/*="pipe"*/) {
+    // Constructor
+    this->name = name;
+    this->data = nullptr;
+    this->data_size = 0;
+    this->stream = &stream;
+    this->stream_finished = false;
+}
+
+
+std::string AudioInput::getName() const {
+    return this->name;
+}
+
+
+bool AudioInput::isStream() const {
+    return this->stream != nullptr;
+}
+
+
+void AudioInput::readStream(uint64_t size) {
+    while(!this->stream_finished && (this->stream_data.size() < size)) {
+        size_t nb_bytes = this->stream_data.size();
+        this->stream_data.resize(nb_bytes + AUDIO_INPUT_CHUNK_SIZE);
+        this->stream->read((char *)(this->stream_data.data() + nb_bytes), (std::streamsize)AUDIO_INPUT_CHUNK_SIZE);
+        size_t nb_read = (size_t)this->stream->gcount();
+        this->stream_data.resize(nb_bytes + nb_read);
+        if(nb_read < AUDIO_INPUT_CHUNK_SIZE) {
+            this->stream_finished = true;
+        }
+    }
+}
+
+
+size_t AudioInput::read(uint64_t position, uint8_t * buffer, size_t size) {
+    if(this->stream == nullptr) {
+        // Buffer of the caller: nothing to synchronize
+        if(position >= this->data_size) {
+            return 0;
+        }
+        size_t nb_bytes = std::min(size, this->data_size - (size_t)position);
+        std::memcpy(buffer, this->data + position, nb_bytes);
+        return nb_bytes;
+    }
+    std::lock_guard<std::mutex> lock(this->stream_mutex);
+    this->readStream(position + size);
+    if(position >= this->stream_data.size()) {
+        return 0;
+    }
+    size_t nb_bytes = std::min(size, this->stream_data.size() - (size_t)position);
+    std::memcpy(buffer, this->stream_data.data() + position, nb_bytes);
+    return nb_bytes;
+}
+
+
+int64_t AudioInput::getSize() const {
+    if(this->stream == nullptr) {
+        return (int64_t)this->data_size;
+    }
+    std::lock_guard<std::mutex> lock(this->stream_mutex);
+    return this->stream_finished ? (int64_t)this->stream_data.size() : -1;
+}
+
+
+int64_t AudioInput::readAll() {
+    if(this->stream == nullptr) {
+        return (int64_t)this->data_size;
+    }
+    std::lock_guard<std::mutex> lock(this->stream_mutex);
+    this->readStream(UINT64_MAX);
+    return (int64_t)this->stream_data.size();
+}
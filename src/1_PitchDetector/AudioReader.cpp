@@ -3,13 +3,22 @@
 #include <iostream>
 #include <cmath>
 #include <limits>
+#include <algorithm>
 
-AudioReader::AudioReader(std::string filepath) {
+AudioReader::AudioReader(std::string filepath) : AudioReader(filepath, true) {
     // Constructor
-    this->filepath = filepath;
+}
+
+
+AudioReader::AudioReader(std::string name, bool check_file) {
+    // Constructor
+    this->filepath = name;
+    this->dst_sample_format = SampleFormat::DOUBLE;
+    this->dst_timestart_s = -1.0;
+    this->dst_timestop_s = -1.0;
     // this->pitch_extractor_ptr = extractor;
     // Check if the audio file exists
-    if(!exists(this->filepath)) {
+    if(check_file && !exists(this->filepath)) {
         throw std::runtime_error("Could not open file");
     }
 }
@@ -65,3 +74,92 @@ int64_t AudioReader::getOutputSampleRate() const{
 double AudioReader::getOutputWindowSize() const{
     return this->dst_windowsize_s;
 }
+
+
+SampleFormat AudioReader::getOutputSampleFormat() const{
+    return this->dst_sample_format;
+}
+
+
+int64_t AudioReader::getExtractionSampleRate(const AudioReaderParameters & parameters, unsigned int audio_stream_ind) const {
+    int64_t stream_rate_hz = this->streams[audio_stream_ind].sample_rate_hz;
+    if(parameters.resample_rate_hz == AUTO_SAMPLE_RATE) {
+        if(parameters.max_frequency_hz <= 0) {
+            return stream_rate_hz;
+        }
+        // Lowest rate whose filtered band covers the maximum frequency (never upsampled)
+        for(auto & rate_hz : AUTO_SAMPLE_RATES_HZ) {
+            if(rate_hz >= stream_rate_hz) {
+                break;
+            }
+            if(AUTO_SAMPLE_RATE_PASSBAND * (double)rate_hz / 2.0 >= parameters.max_frequency_hz) {
+                return rate_hz;
+            }
+        }
+        return stream_rate_hz;
+    } else if(parameters.resample_rate_hz < 0) {
+        // Same sample rate as input
+        return stream_rate_hz;
+    }
+    return parameters.resample_rate_hz;
+}
+
+
+bool AudioReader::getNextBufferView(BufferView<double> & view) {
+    bool ret = this->getNextBuffer(this->view_buffer);
+    view.samples = this->view_buffer.data();
+    view.size = this->view_buffer.size();
+    return ret;
+}
+
+
+bool AudioReader::getNextBufferView(BufferView<float> & view) {
+    bool ret = this->getNextBuffer(this->view_buffer_float);
+    view.samples = this->view_buffer_float.data();
+    view.size = this->view_buffer_float.size();
+    return ret;
+}
+
+
+void AudioReader::selectWindows(uint64_t /*first_window*/, int64_t /*nb_windows=-1*/) {
+    throw std::runtime_error("This audio reader does not support window selection");
+}
+
+
+std::unique_ptr<AudioReader> AudioReader::clone() const {
+    return std::unique_ptr<AudioReader>();
+}
+
+
+uint64_t AudioReader::getExpectedNumberOfBuffers(unsigned int audio_stream_ind/*=0*/) const{
+    if(audio_stream_ind >= this->streams.size()) {
+        throw std::runtime_error("Invalid input index");
+    }
+    const AudioStream & stream = this->streams[audio_stream_ind];
+    if(stream.sample_rate_hz <= 0) {
+        return 0;
+    }
+    double rate_ratio = (double)this->dst_rate_hz / (double)stream.sample_rate_hz;
+    int64_t nb_samples = (int64_t)floor((double)stream.nb_samples * rate_ratio);
+    // Time range
+    if(this->dst_timestop_s >= 0) {
+        nb_samples = std::min(nb_samples, (int64_t)round(this->dst_timestop_s * (double)this->dst_rate_hz));
+    }
+    if(this->dst_timestart_s > 0) {
+        nb_samples -= (int64_t)round(this->dst_timestart_s * (double)this->dst_rate_hz);
+    }
+    int64_t window_size = (int64_t)round(this->dst_windowsize_s * (double)this->dst_rate_hz);
+    double hop_size = this->dst_period_s * (double)this->dst_rate_hz;
+    if((nb_samples < window_size) || (hop_size <= 0)) {
+        return 0;
+    }
+    // Last buffer ending inside the stream
+    uint64_t nb_buffers = (uint64_t)floor((double)(nb_samples - window_size) / hop_size) + 1;
+    while(get_window_start(hop_size, nb_buffers) + window_size <= nb_samples) {
+        nb_buffers++;
+    }
+    while((nb_buffers > 0) && (get_window_start(hop_size, nb_buffers - 1) + window_size > nb_samples)) {
+        nb_buffers--;
+    }
+    return nb_buffers;
+}
@@ -0,0 +1,19 @@
+#include "AudioReaderFactory.hpp"
+#include "WavAudioReader.hpp"
+#include "FFmpegAudioReader.hpp"
+#include <stdexcept>
+
+
+std::unique_ptr<AudioReader> create_audio_reader(const std::string & filepath) {
+    try {
+        return std::unique_ptr<AudioReader>(new WavAudioReader(filepath));
+    } catch(const std::runtime_error &) {
+        // Not a supported WAV file
+    }
+    return std::unique_ptr<AudioReader>(new FFmpegAudioReader(filepath));
+}
+
+
+std::unique_ptr<AudioReader> create_audio_reader(std::shared_ptr<AudioInput> input) {
+    return std::unique_ptr<AudioReader>(new FFmpegAudioReader(input));
+}
@@ -1,7 +1,12 @@
 #include "FFmpegAudioReader.hpp"
+#include "common_tools.hpp"
 #include <iostream>
 #include <string>
 #include <fstream>
+#include <cmath>
+#include <algorithm>
+#include <cstdio>
+#include <cerrno>
 
 extern "C" {
     #include <libavformat/avformat.h>
@@ -25,19 +30,21 @@ void FFmpegAudioReader::FreeConvertedSamples() {
     if (this->ppConvertedInputSamples) {
         av_freep(&(this->ppConvertedInputSamples)[0]);
         free(this->ppConvertedInputSamples);
+        this->ppConvertedInputSamples = NULL;
     }
+    this->nb_converted_samples_capacity = 0;
 }
 
 
-void FFmpegAudioReader::FreeInputFrame() {
-    av_frame_free(&(this->pInputFrame));
-    this->pInputFrame = NULL;
+void FFmpegAudioReader::FreePacket() {
+    av_packet_free(&(this->pPacket));
+    this->pPacket = NULL;
 }
 
 
-void FFmpegAudioReader::FreeOutputFrame() {
-    av_frame_free(&(this->pOutputFrame));
-    this->pOutputFrame = NULL;
+void FFmpegAudioReader::FreeInputFrame() {
+    av_frame_free(&(this->pInputFrame));
+    this->pInputFrame = NULL;
 }
 
 
@@ -50,6 +57,16 @@ void FFmpegAudioReader::FreeCodecCtx() {
 void FFmpegAudioReader::FreeFormatCtx() {
     avformat_close_input(&(this->pFormatCtx));
     this->pFormatCtx = NULL;
+    this->FreeIOCtx();
+}
+
+
+void FFmpegAudioReader::FreeIOCtx() {
+    if(this->pIOCtx) {
+        av_freep(&(this->pIOCtx->buffer));
+        avio_context_free(&(this->pIOCtx));
+    }
+    this->pIOCtx = NULL;
 }
 
 
@@ -65,19 +82,28 @@ void FFmpegAudioReader::FreeAudioFifo() {
 }
 
 
-void FFmpegAudioReader::ConvertInputFrame() {
-    /* Convert the samples using the resampler. */
-    if (swr_convert(this->pSwrCtx,
-                    this->ppConvertedInputSamples,
-                    this->nb_samples_out,
-                    (const uint8_t**)this->pInputFrame->extended_data,
-                    this->pInputFrame->nb_samples) < 0) {
+void FFmpegAudioReader::ConvertInputFrame(const uint8_t **input_samples, int nb_input_samples) {
+    /* Convert the samples using the resampler, the number of
+     * converted samples is the one given by the resampler. */
+    int nb_converted = swr_convert(this->pSwrCtx,
+                                   this->ppConvertedInputSamples,
+                                   (int)this->nb_samples_out,
+                                   input_samples,
+                                   nb_input_samples);
+    if (nb_converted < 0) {
         throw std::runtime_error("Could not convert input samples");
     }
+    this->nb_samples_out = nb_converted;
 }
 
 
 void FFmpegAudioReader::InitConvertedSamples() {
+    /* The storage is kept from one frame to the next, it is only
+     * reallocated for a frame larger than all the previous ones. */
+    if (this->nb_samples_out <= this->nb_converted_samples_capacity) {
+        return;
+    }
+    this->FreeConvertedSamples();
     int error;
     /* Allocate as many pointers as there are audio channels.
      * Each pointer will later point to the audio samples of the corresponding
@@ -101,14 +127,21 @@ void FFmpegAudioReader::InitConvertedSamples() {
         this->FreeConvertedSamples();
         throw std::runtime_error("Could not allocate converted input samples");
     }
+    this->nb_converted_samples_capacity = this->nb_samples_out;
+    this->nb_allocations++;
 }
 
 
 void FFmpegAudioReader::AddSamplesToFifo() {
     /* Make the FIFO as large as it needs to be to hold both,
-     * the old and the new samples. */
-    if (av_audio_fifo_realloc(this->pAudioFifo, av_audio_fifo_size(this->pAudioFifo) + this->nb_samples_out) < 0) {
-        throw std::runtime_error("Could not reallocate FIFO");
+     * the old and the new samples (its size is doubled to be reallocated only a few times). */
+    int64_t nb_samples = av_audio_fifo_size(this->pAudioFifo) + this->nb_samples_out;
+    if (nb_samples > this->fifo_capacity) {
+        this->fifo_capacity = std::max(2 * this->fifo_capacity, nb_samples);
+        if (av_audio_fifo_realloc(this->pAudioFifo, (int)this->fifo_capacity) < 0) {
+            throw std::runtime_error("Could not reallocate FIFO");
+        }
+        this->nb_allocations++;
     }
     /* Store the new samples in the FIFO buffer. */
     if (av_audio_fifo_write(this->pAudioFifo, (void **)(this->ppConvertedInputSamples),
@@ -118,66 +151,45 @@ void FFmpegAudioReader::AddSamplesToFifo() {
 }
 
 
-void FFmpegAudioReader::GetNbSamplesOut() {
-    int64_t sample_rate_out;
-    int64_t sample_rate_in;
-    av_opt_get_int(this->pSwrCtx, "osr", 0, &sample_rate_out);
-    av_opt_get_int(this->pSwrCtx, "isr", 0, &sample_rate_in);
-    this->nb_samples_out = (int64_t)floor(((double)(this->pInputFrame->nb_samples-1)/(double)sample_rate_in)*(double)sample_rate_out) + 1;
-}
-
-
-void FFmpegAudioReader::ConvertAndStoreOneFrame() {
-    /* Temporary storage for the converted input samples. */
-    const std::runtime_error *error = NULL;
-    try {
-        /* Initialize the temporary storage for the converted input samples. */
-        this->GetNbSamplesOut();
-
-        this->InitConvertedSamples();
-        /* Convert the input samples to the desired output sample format.
-         * This requires a temporary storage provided by this->ppConvertedInputSamples. */
-        this->ConvertInputFrame();
-        /* Add the converted input samples to the FIFO buffer for later processing. */
-        this->AddSamplesToFifo();
-    } catch(const std::runtime_error& e) {
-        error = &e;
-    }
-    // Free memory
-    this->FreeConvertedSamples();
-    // If error != NULL then an error occured
-    if(error != NULL) {
-        throw *error;
+void FFmpegAudioReader::GetNbSamplesOut(int nb_input_samples) {
+    /* Upper bound of the number of samples given by the resampler (including the delayed ones). */
+    this->nb_samples_out = swr_get_out_samples(this->pSwrCtx, nb_input_samples);
+    if (this->nb_samples_out < 0) {
+        throw std::runtime_error("Could not get the number of output samples");
     }
 }
 
 
-void FFmpegAudioReader::InitOutputFrame() {
-    int64_t dst_ch_layout;
-    enum AVSampleFormat dst_sample_fmt;
-    int64_t dst_rate;
-    av_opt_get_int(this->pSwrCtx, "ocl", 0, &dst_ch_layout);
-    av_opt_get_int(this->pSwrCtx, "osr", 0, &dst_rate);
-    av_opt_get_sample_fmt(this->pSwrCtx, "osf", 0, &dst_sample_fmt);
-    /* Create a new frame to store the audio samples. */
-    if (!(this->pOutputFrame = av_frame_alloc())) {
-        throw std::runtime_error("Could not allocate output frame");
-    }
-    /* Set the frame's parameters, especially its size and format.
-     * av_frame_get_buffer needs this to allocate memory for the
-     * audio samples of the frame.
-     * Default channel layouts based on the number of channels
-     * are assumed for simplicity. */
-    this->pOutputFrame->nb_samples     = this->WS_resampled;
-    this->pOutputFrame->channel_layout = dst_ch_layout;
-    this->pOutputFrame->format         = dst_sample_fmt;
-    this->pOutputFrame->sample_rate    = dst_rate;
-    /* Allocate the samples of the created frame. This call will make
-     * sure that the audio frame can hold as many samples as specified. */
-    if (av_frame_get_buffer(this->pOutputFrame, 0) < 0) {
-        this->FreeOutputFrame();
-        throw std::runtime_error("Could not allocate output frame samples");
+void FFmpegAudioReader::ConvertAndStoreOneFrame() {
+    const uint8_t **input_samples = (const uint8_t**)this->pInputFrame->extended_data;
+    int nb_input_samples = this->pInputFrame->nb_samples;
+    if (this->nb_input_samples_to_drop > 0) {
+        /* The first samples of the frame are not given to the resampler (phase of the resampler
+         * after a seek), the planes of the frame are read from the first kept sample. */
+        int nb_dropped = (int)std::min(this->nb_input_samples_to_drop, (int64_t)nb_input_samples);
+        enum AVSampleFormat sample_fmt = (enum AVSampleFormat)this->pInputFrame->format;
+        bool planar = av_sample_fmt_is_planar(sample_fmt) != 0;
+        int nb_channels = this->pInputFrame->channels;
+        int offset = nb_dropped * av_get_bytes_per_sample(sample_fmt) * (planar ? 1 : nb_channels);
+        this->input_planes.resize(planar ? (size_t)nb_channels : 1);
+        for (size_t k = 0; k < this->input_planes.size(); k++) {
+            this->input_planes[k] = this->pInputFrame->extended_data[k] + offset;
+        }
+        input_samples = this->input_planes.data();
+        nb_input_samples -= nb_dropped;
+        this->nb_input_samples_to_drop -= nb_dropped;
+        if (nb_input_samples == 0) {
+            return;
+        }
     }
+    /* Temporary storage for the converted input samples (freed with the extraction). */
+    this->GetNbSamplesOut(nb_input_samples);
+    this->InitConvertedSamples();
+    /* Convert the input samples to the desired output sample format.
+     * This requires a temporary storage provided by this->ppConvertedInputSamples. */
+    this->ConvertInputFrame(input_samples, nb_input_samples);
+    /* Add the converted input samples to the FIFO buffer for later processing. */
+    this->AddSamplesToFifo();
 }
 
 
@@ -191,13 +203,18 @@ void FFmpegAudioReader::InitAudioFifo() {
     if (!(this->pAudioFifo = av_audio_fifo_alloc(dst_sample_fmt, nb_channels, 1))) {
         throw std::runtime_error("Could not allocate FIFO");
     }
+    this->fifo_capacity = 1;
 }
 
 
 void FFmpegAudioReader::InitSwrCtx() {
+    enum AVSampleFormat dst_sample_fmt = AV_SAMPLE_FMT_DBL;
+    if(this->dst_sample_format == SampleFormat::FLOAT) {
+        dst_sample_fmt = AV_SAMPLE_FMT_FLT;
+    }
     this->pSwrCtx = swr_alloc_set_opts(NULL,
                                         AV_CH_LAYOUT_MONO,
-                                        AV_SAMPLE_FMT_DBL,
+                                        dst_sample_fmt,
                                         this->dst_rate_hz,
                                         av_get_default_channel_layout(this->pCodecCtx->channels),
                                         this->pCodecCtx->sample_fmt,
@@ -223,41 +240,62 @@ void FFmpegAudioReader::InitInputFrame() {
 
 void FFmpegAudioReader::DecodeOneAudioFrame() {
     this->data_present = false;
-    /* Packet used for temporary storage. */
-    AVPacket input_packet;
+    /* Packet used for temporary storage (allocated once). */
+    if (this->pPacket == NULL) {
+        if (!(this->pPacket = av_packet_alloc())) {
+            throw std::runtime_error("Could not allocate packet");
+        }
+        this->nb_allocations++;
+    }
+    AVPacket & input_packet = *(this->pPacket);
     int error;
-    init_packet(&input_packet);
-    /* Read one audio frame from the input file into a temporary packet. */
-    if ((error = av_read_frame(this->pFormatCtx, &input_packet)) < 0) {
-        /* If we are at the end of the file, flush the decoder below. */
-        if (error == AVERROR_EOF)
+    while (1) {
+        /* Receive one frame from the decoder: the frames left from the previous
+         * packets are returned before a new packet is read. */
+        error = avcodec_receive_frame(this->pCodecCtx, this->pInputFrame);
+        if (error >= 0) {
+            this->data_present = true;
+            this->nb_decoded_frames++;
+            return;
+        }
+        /* If the decoder is flushed, stop decoding. */
+        if (error == AVERROR_EOF) {
             this->finished = true;
-        else {
+            return;
+        }
+        if (error != AVERROR(EAGAIN)) {
+            throw std::runtime_error("Could not decode frame");
+        }
+        /* The decoder asks for more data: read one packet of the audio stream from the input file. */
+        if ((error = av_read_frame(this->pFormatCtx, &input_packet)) < 0) {
+            /* If we are at the end of the file, flush the decoder (empty packet). */
+            if (error != AVERROR_EOF) {
+                av_packet_unref(&input_packet);
+                throw std::runtime_error("Could not read frame");
+            }
+        } else if (input_packet.stream_index != this->ind_stream_extraction) {
+            /* Packet of another stream (not discarded by the demuxer) */
             av_packet_unref(&input_packet);
-            throw std::runtime_error("Could not read frame");
+            continue;
         }
-    }
-    /* Send the audio frame stored in the temporary packet to the decoder.
-     * The input audio stream decoder is used to do this. */
-    if ((error = avcodec_send_packet(this->pCodecCtx, &input_packet)) < 0) {
+        /* Send the packet to the decoder of the audio stream. */
+        error = avcodec_send_packet(this->pCodecCtx, (input_packet.data == NULL) ? NULL : &input_packet);
         av_packet_unref(&input_packet);
-        throw std::runtime_error("Could not send packet for decoding");
-    }
-    /* Receive one frame from the decoder. */
-    error = avcodec_receive_frame(this->pCodecCtx, this->pInputFrame);
-    av_packet_unref(&input_packet);
-    /* If the decoder asks for more data to be able to decode a frame,
-     * return indicating that no data is present. */
-    if (error == AVERROR(EAGAIN)) {
-        this->data_present = false;
-    /* If the end of the input file is reached, stop decoding. */
-    } else if (error == AVERROR_EOF) {
-        this->finished = true;
-    } else if (error < 0) {
-        throw std::runtime_error("Could not decode frame");
-    /* Default case: Return decoded data. */
-    } else {
-        this->data_present = true;
+        if (error == AVERROR_EOF) {
+            this->finished = true;
+            return;
+        } else if (error < 0) {
+            throw std::runtime_error("Could not send packet for decoding");
+        }
+    }
+}
+
+
+void FFmpegAudioReader::SelectStream(int ind_stream) {
+    /* The demuxer skips the packets of the other streams (video, other audio tracks...). */
+    this->ind_stream_extraction = ind_stream;
+    for (unsigned int k = 0; k < this->pFormatCtx->nb_streams; k++) {
+        this->pFormatCtx->streams[k]->discard = ((int)k == ind_stream) ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
     }
 }
 
@@ -320,11 +358,88 @@ std::vector<unsigned int> FFmpegAudioReader::ExtractAudioStreamsIndex() {
 }
 
 
+int FFmpegAudioReader::ReadInput(void *opaque, uint8_t *buf, int buf_size) {
+    FFmpegAudioReader *reader = (FFmpegAudioReader *)opaque;
+    size_t nb_bytes = reader->input->read((uint64_t)reader->input_position, buf, (size_t)buf_size);
+    if(nb_bytes == 0) {
+        return AVERROR_EOF;
+    }
+    reader->input_position += (int64_t)nb_bytes;
+    return (int)nb_bytes;
+}
+
+
+int64_t FFmpegAudioReader::SeekInput(void *opaque, int64_t offset, int whence) {
+    FFmpegAudioReader *reader = (FFmpegAudioReader *)opaque;
+    int64_t position;
+    /* The size of a stream is unknown until its end has been read: reject the requests that
+       would read it in full (a stream is read forward, the demuxers can still go back in the
+       bytes already read). */
+    int64_t size = reader->input->getSize();
+    switch(whence & ~AVSEEK_FORCE) {
+        case AVSEEK_SIZE:
+            return (size >= 0) ? size : AVERROR(ENOSYS);
+        case SEEK_SET:
+            position = offset;
+            break;
+        case SEEK_CUR:
+            position = reader->input_position + offset;
+            break;
+        case SEEK_END:
+            if(size < 0) {
+                return AVERROR(ENOSYS);
+            }
+            position = size + offset;
+            break;
+        default:
+            return AVERROR(EINVAL);
+    }
+    if(position < 0) {
+        return AVERROR(EINVAL);
+    }
+    reader->input_position = position;
+    return position;
+}
+
+
+void FFmpegAudioReader::InitIOCtx() {
+    /* The input is read by the callbacks, each reader has its own position in it. */
+    this->input_position = 0;
+    unsigned char *io_buffer = (unsigned char *)av_malloc(FFMPEG_AUDIO_READER_IO_BUFFER_SIZE);
+    if (!io_buffer) {
+        throw std::runtime_error("Could not allocate I/O buffer");
+    }
+    this->pIOCtx = avio_alloc_context(io_buffer, FFMPEG_AUDIO_READER_IO_BUFFER_SIZE, 0, this,
+                                      &FFmpegAudioReader::ReadInput, NULL, &FFmpegAudioReader::SeekInput);
+    if (!this->pIOCtx) {
+        av_free(io_buffer);
+        throw std::runtime_error("Could not allocate I/O context");
+    }
+    if (this->input->isStream()) {
+        /* Not seekable: the demuxers do not look for the end of the input (size, tags). */
+        this->pIOCtx->seekable = 0;
+    }
+}
+
+
 void FFmpegAudioReader::GetFormatCtxAndStreamInfo() {
     const char * tempfilepath = this->filepath.c_str();
+    if (this->input) {
+        /* Input which is not a file: read through a custom I/O context. */
+        this->InitIOCtx();
+        this->pFormatCtx = avformat_alloc_context();
+        if (!this->pFormatCtx) {
+            this->FreeIOCtx();
+            throw std::runtime_error("Could not allocate format context");
+        }
+        this->pFormatCtx->pb = this->pIOCtx;
+        this->pFormatCtx->flags |= AVFMT_FLAG_CUSTOM_IO;
+        tempfilepath = NULL;
+    }
     /* Open the input file to read from it. */
     if (avformat_open_input(&(this->pFormatCtx), tempfilepath, NULL, NULL) < 0) {
         this->pFormatCtx = NULL;
+        this->FreeIOCtx();
         throw std::runtime_error("Could not open input file");
     }
     /* Get information on the input file (number of streams etc.). */
@@ -335,64 +450,200 @@ void FFmpegAudioReader::GetFormatCtxAndStreamInfo() {
 }
 
 
+void FFmpegAudioReader::RewindFormatCtx() {
+    if(!this->format_ctx_read) {
+        return;
+    }
+    /* Go back to the beginning of the input, or reopen it if it is not seekable. */
+    int64_t start_time = (this->pFormatCtx->start_time != AV_NOPTS_VALUE) ? this->pFormatCtx->start_time : 0;
+    if(av_seek_frame(this->pFormatCtx, -1, start_time, AVSEEK_FLAG_BACKWARD) < 0) {
+        this->FreeFormatCtx();
+        this->GetFormatCtxAndStreamInfo();
+    }
+    this->format_ctx_read = false;
+}
+
+
 void FFmpegAudioReader::updateIndexNextIteration(){
     this->iteration += 1;
-    this->ind_start = (int64_t)round((this->dst_period_s * this->iteration)*(double)this->dst_rate_hz);
+    // Windows of the grid of the whole extraction, relative to the first selected one
+    double hop_size = this->dst_period_s * (double)this->dst_rate_hz;
+    this->ind_start = get_window_start(hop_size, this->first_window + (uint64_t)this->iteration) - this->window_offset;
     this->ind_stop = this->ind_start + this->WS_resampled;
 }
 
 
+void FFmpegAudioReader::SeekToFirstSample() {
+    if((this->ind_first_sample <= 0) && !this->seek_pending) {
+        // Already at the beginning
+        return;
+    }
+    AVStream *stream = this->pFormatCtx->streams[this->ind_stream_extraction];
+    int64_t start_time = (stream->start_time != AV_NOPTS_VALUE) ? stream->start_time : 0;
+    double time_s = std::max((double)this->ind_first_sample / (double)this->dst_rate_hz
+                             - FFMPEG_AUDIO_READER_PREROLL_S - this->decoder_preroll_s, 0.0);
+    int64_t timestamp = start_time + (int64_t)floor(time_s / av_q2d(stream->time_base));
+    /* Seek to the keyframe preceding the first sample, the exact position is
+     * known from the timestamp of the first decoded frame. */
+    if(av_seek_frame(this->pFormatCtx, this->ind_stream_extraction, timestamp, AVSEEK_FLAG_BACKWARD) >= 0) {
+        avcodec_flush_buffers(this->pCodecCtx);
+        this->seek_pending = true;
+    } else if(!this->seek_pending) {
+        /* Input not seekable: decode from the beginning */
+        this->nb_samples_to_skip = this->ind_first_sample;
+    }
+}
+
+
+bool FFmpegAudioReader::AlignFirstFrameAfterSeek() {
+    if(!this->seek_pending) {
+        return true;
+    }
+    this->seek_pending = false;
+    this->nb_samples_to_skip = 0;
+    this->nb_input_samples_to_drop = 0;
+    AVStream *stream = this->pFormatCtx->streams[this->ind_stream_extraction];
+    int64_t start_time = (stream->start_time != AV_NOPTS_VALUE) ? stream->start_time : 0;
+    int64_t pts = this->pInputFrame->best_effort_timestamp;
+    if(pts == AV_NOPTS_VALUE) {
+        // Position unknown: the frame is dropped and the stream is decoded from the beginning
+        if(av_seek_frame(this->pFormatCtx, this->ind_stream_extraction, start_time, AVSEEK_FLAG_BACKWARD) < 0) {
+            throw std::runtime_error("Could not seek in the input");
+        }
+        avcodec_flush_buffers(this->pCodecCtx);
+        this->nb_samples_to_skip = this->ind_first_sample;
+        return false;
+    }
+    // Index of the first input sample of the frame
+    AVRational input_time_base = {1, this->pCodecCtx->sample_rate};
+    int64_t ind_input = av_rescale_q(pts - start_time, stream->time_base, input_time_base);
+    // The resampler starts at the next input sample which is also on the grid of the output samples
+    // (input_step input samples for output_step output samples): its output samples are then the ones
+    // of a decoding from the beginning of the stream, once the resampler filter is filled (preroll)
+    int64_t rates_gcd = av_gcd(this->pCodecCtx->sample_rate, this->dst_rate_hz);
+    int64_t input_step = this->pCodecCtx->sample_rate / rates_gcd;
+    int64_t output_step = this->dst_rate_hz / rates_gcd;
+    int64_t ind_input_aligned = ind_input - (ind_input % input_step);
+    if(ind_input_aligned < ind_input) {
+        ind_input_aligned += input_step;
+    }
+    this->nb_input_samples_to_drop = ind_input_aligned - ind_input;
+    this->nb_samples_to_skip = this->ind_first_sample - (ind_input_aligned / input_step) * output_step;
+    return true;
+}
+
+
+void FFmpegAudioReader::SkipSamplesBeforeFirstSample() {
+    if(this->nb_samples_to_skip > 0) {
+        int64_t nb_samples = std::min(this->nb_samples_to_skip, (int64_t)av_audio_fifo_size(this->pAudioFifo));
+        if(av_audio_fifo_drain(this->pAudioFifo, nb_samples) < 0) {
+            throw std::runtime_error("Could not drain data from FIFO");
+        }
+        this->nb_samples_to_skip -= nb_samples;
+    }
+}
+
+
 /* PUBLIC FUNCTIONS */
 /********************/
-FFmpegAudioReader::FFmpegAudioReader(std::string filepath) : AudioReader(filepath) {
+FFmpegAudioReader::FFmpegAudioReader(std::string filepath, ProbeMode probe_mode/*=ProbeMode::FAST*/) : AudioReader(filepath) {
+    this->InitMembers();
+    this->Init(probe_mode);
+}
+
+
+FFmpegAudioReader::FFmpegAudioReader(std::shared_ptr<AudioInput> input, ProbeMode probe_mode/*=ProbeMode::FAST*/)
+    : AudioReader(input->getName(), false) {
+    this->InitMembers();
+    this->input = input;
+    this->Init(probe_mode);
+}
+
+
+void FFmpegAudioReader::InitMembers() {
+    this->pIOCtx = NULL;
+    this->input_position = 0;
     this->pFormatCtx = NULL;
     this->pCodecCtx = NULL;
     this->pInputFrame = NULL;
     this->pSwrCtx = NULL;
     this->pAudioFifo = NULL;
-    this->pOutputFrame = NULL;
     this->ppConvertedInputSamples = NULL;
+    this->nb_converted_samples_capacity = 0;
+    this->pPacket = NULL;
+    this->fifo_capacity = 0;
+    this->nb_allocations = 0;
+    this->nb_decoded_frames = 0;
     this->nb_samples_out = 0;
     this->data_present = false;
     this->finished = false;
-    unsigned long int nb_samples;
-    // Get format context (this->pFormatCtx)
+    this->ind_stream_extraction = -1;
+    this->seek_pending = false;
+    this->nb_samples_to_skip = 0;
+    this->nb_input_samples_to_drop = 0;
+    this->decoder_preroll_s = 0.0;
+    this->ind_first_sample = 0;
+    this->ind_last_sample = -1;
+    this->first_window = 0;
+    this->window_offset = 0;
+    this->nb_windows_max = -1;
+    this->format_ctx_read = false;
+}
+
+
+void FFmpegAudioReader::Init(ProbeMode probe_mode) {
+    // Get format context (this->pFormatCtx), kept open for the first extraction
     this->GetFormatCtxAndStreamInfo();
     // Get indices of audio streams only
     std::vector<unsigned int> indices_audio_streams;
     indices_audio_streams = this->ExtractAudioStreamsIndex();
     for(auto& ind : indices_audio_streams) {
+        AVStream *stream = this->pFormatCtx->streams[ind];
+        AudioStream temp_stream;
         // Get decoder and Get number of samples
         try {
             // Get codec context (this->pCodecCtx)
             this->GetCodecCtx(ind);
-            nb_samples = this->ExtractNumberOfSample();
+            temp_stream.sample_rate_hz = stream->codecpar->sample_rate;
+            // Duration from the metadata of the stream or of the container
+            temp_stream.duration_s = -1.0;
+            if(stream->duration != AV_NOPTS_VALUE) {
+                temp_stream.duration_s = (double)stream->duration * av_q2d(stream->time_base);
+            } else if(this->pFormatCtx->duration != AV_NOPTS_VALUE) {
+                temp_stream.duration_s = (double)this->pFormatCtx->duration / (double)AV_TIME_BASE;
+            }
+            if((probe_mode == ProbeMode::EXACT) || (temp_stream.duration_s < 0)) {
+                // Decode the whole stream to count the samples
+                this->RewindFormatCtx();
+                this->SelectStream(ind);
+                temp_stream.nb_samples = this->ExtractNumberOfSample();
+                this->format_ctx_read = true;
+                if(temp_stream.duration_s < 0) {
+                    temp_stream.duration_s = (double)temp_stream.nb_samples / (double)temp_stream.sample_rate_hz;
+                }
+            } else {
+                temp_stream.nb_samples = (unsigned long int)round(temp_stream.duration_s * (double)temp_stream.sample_rate_hz);
+            }
         }
         catch(std::runtime_error& e) {
             // Failed to get decoder
             this->FreeCodecCtx();
+            this->FreeFormatCtx();
             throw e;
-            continue;
         }
         // Add this stream as valid audio stream
-        AudioStream temp_stream;
         temp_stream.ind_stream = (unsigned int)ind;
         temp_stream.format = pCodecCtx->codec->name;
-        temp_stream.sample_rate_hz = pFormatCtx->streams[ind]->codecpar->sample_rate;
-        temp_stream.nb_channels = (unsigned int)pFormatCtx->streams[ind]->codecpar->channels;
+        temp_stream.nb_channels = (unsigned int)stream->codecpar->channels;
         temp_stream.bit_rate = (unsigned long int)pCodecCtx->bit_rate;
-        temp_stream.duration_s = (double)pFormatCtx->streams[ind]->duration / (double)pFormatCtx->streams[ind]->time_base.den;
-        temp_stream.nb_samples = nb_samples;
         this->streams.push_back(temp_stream);
         this->FreeCodecCtx();
     }
-    // Free the codec context and everything associated with it and write NULL to the provided pointer.
-    this->FreeFormatCtx();
     // Check if a valid audio stream has been found
     if(this->streams.size() == 0) {
+        this->FreeFormatCtx();
         throw std::runtime_error("Could not find valid audio stream");
     }
-
 }
 
 void FFmpegAudioReader::initExtraction( const AudioReaderParameters & parameters/*=DEFAULT_AUDIO_READER_PARAMETERS*/,
@@ -401,85 +652,176 @@ void FFmpegAudioReader::initExtraction( const AudioReaderParameters & parameters
                                         double timestop_s/*=-1.0*/
                                         ) {
     this->FreeInputFrame();
+    this->FreeConvertedSamples();
+    this->FreePacket();
     this->FreeAudioFifo();
     this->FreeSwrCtx();
-    this->FreeOutputFrame();
     this->FreeCodecCtx();
-    this->FreeFormatCtx();
     // Time start and time stop
-    if(timestart_s >= 0) {
-        throw std::runtime_error("Function not yet implemented");
-    }
-    if(timestop_s >= 0) {
-        throw std::runtime_error("Function not yet implemented");
+    if((timestop_s >= 0) && (timestop_s <= std::max(timestart_s, 0.0))) {
+        throw std::runtime_error("Invalid time range");
     }
     if(audio_stream_ind >= this->streams.size()) {
         throw std::runtime_error("Invalid input index");
     }
-    if(parameters.resample_rate_hz < 0) {
-        // Same sample rate as input
-        this->dst_rate_hz = this->streams[audio_stream_ind].sample_rate_hz;
-    } else {
-        this->dst_rate_hz = parameters.resample_rate_hz;
-    }
+    this->dst_rate_hz = this->getExtractionSampleRate(parameters, audio_stream_ind);
     this->dst_period_s = parameters.period_s;
     this->dst_windowsize_s = parameters.windowstimesize_s;
-    // Get format context
-    this->GetFormatCtxAndStreamInfo();
+    this->dst_sample_format = parameters.sample_format;
+    this->dst_timestart_s = timestart_s;
+    this->dst_timestop_s = timestop_s;
+    // Get format context (the one of the constructor or of the previous extraction is reused)
+    if(this->pFormatCtx == NULL) {
+        this->GetFormatCtxAndStreamInfo();
+    } else {
+        this->RewindFormatCtx();
+    }
+    this->format_ctx_read = true;
     // Get codec context
-    int ind = this->streams[audio_stream_ind].ind_stream;
-    this->GetCodecCtx(ind);
+    this->SelectStream(this->streams[audio_stream_ind].ind_stream);
+    this->GetCodecCtx(this->ind_stream_extraction);
+    // Independent lossless frames (PCM, FLAC...) are exact from the first frame after a seek, the
+    // other codecs need the previous frames to decode a frame
+    const AVCodecDescriptor *descriptor = avcodec_descriptor_get(this->pCodecCtx->codec_id);
+    int exact_props = AV_CODEC_PROP_INTRA_ONLY | AV_CODEC_PROP_LOSSLESS;
+    bool exact_frames = (descriptor != NULL) && ((descriptor->props & exact_props) == exact_props);
+    this->decoder_preroll_s = exact_frames ? 0.0 : FFMPEG_AUDIO_READER_DECODER_PREROLL_S;
+    // Output samples of the time range
+    this->ind_first_sample = (int64_t)round(std::max(timestart_s, 0.0) * (double)this->dst_rate_hz);
+    this->ind_last_sample = (timestop_s >= 0) ? (int64_t)round(timestop_s * (double)this->dst_rate_hz) : -1;
+    this->first_window = 0;
+    this->window_offset = 0;
+    this->nb_windows_max = -1;
+    this->seek_pending = false;
+    this->nb_samples_to_skip = 0;
+    this->nb_input_samples_to_drop = 0;
+    this->SeekToFirstSample();
     /* Initialize the resampler to be able to convert audio sample formats. */
     this->InitSwrCtx();
     /* Initialize the FIFO buffer to store audio samples to be encoded. */
     this->InitAudioFifo();
     // Size of the windows 
     this->WS_resampled = (int64_t)round(this->dst_windowsize_s*(double)this->dst_rate_hz);
-    this->InitOutputFrame();
     this->InitInputFrame();
+    this->nb_allocations = 0;
+    this->nb_decoded_frames = 0;
     this->finished = false;
     // Index of the first audio buffer to get
     this->iteration = -1;
     this->temp_buffer_start = 0;
     this->temp_buffer_stop = 0;
     this->temp_buffer.clear();
+    this->temp_buffer_float.clear();
+}
+
+
+void FFmpegAudioReader::selectWindows(uint64_t first_window, int64_t nb_windows/*=-1*/) {
+    if((this->pFormatCtx == NULL) || (this->iteration >= 0)) {
+        throw std::runtime_error("Windows must be selected between initExtraction() and the first buffer");
+    }
+    double hop_size = this->dst_period_s * (double)this->dst_rate_hz;
+    int64_t ind_range_start = (int64_t)round(std::max(this->dst_timestart_s, 0.0) * (double)this->dst_rate_hz);
+    this->first_window = first_window;
+    this->window_offset = get_window_start(hop_size, first_window);
+    this->nb_windows_max = nb_windows;
+    if(ind_range_start + this->window_offset != this->ind_first_sample) {
+        this->ind_first_sample = ind_range_start + this->window_offset;
+        this->SeekToFirstSample();
+    }
+}
+
+
+uint64_t FFmpegAudioReader::getNumberOfAllocations() const {
+    return this->nb_allocations;
+}
+
+
+uint64_t FFmpegAudioReader::getNumberOfDecodedFrames() const {
+    return this->nb_decoded_frames;
+}
+
+
+std::unique_ptr<AudioReader> FFmpegAudioReader::clone() const {
+    return std::unique_ptr<AudioReader>(new FFmpegAudioReader(*this));
 }
 
 
 bool FFmpegAudioReader::getNextBuffer(std::vector<double> & buffer) {
-    buffer.clear();
+    BufferView<double> view;
+    bool ret = this->getNextBufferView(view);
+    buffer.assign(view.samples, view.samples + view.size);
+    return ret;
+}
+
+
+bool FFmpegAudioReader::getNextBuffer(std::vector<float> & buffer) {
+    BufferView<float> view;
+    bool ret = this->getNextBufferView(view);
+    buffer.assign(view.samples, view.samples + view.size);
+    return ret;
+}
+
+
+bool FFmpegAudioReader::getNextBufferView(BufferView<double> & view) {
+    if(this->dst_sample_format != SampleFormat::DOUBLE) {
+        throw std::runtime_error("Buffer type does not match the sample format of the extraction");
+    }
+    return this->extractNextBuffer(view, this->temp_buffer);
+}
+
+
+bool FFmpegAudioReader::getNextBufferView(BufferView<float> & view) {
+    if(this->dst_sample_format != SampleFormat::FLOAT) {
+        throw std::runtime_error("Buffer type does not match the sample format of the extraction");
+    }
+    return this->extractNextBuffer(view, this->temp_buffer_float);
+}
+
+
+template<typename T>
+bool FFmpegAudioReader::extractNextBuffer(BufferView<T> & view, std::vector<T> & temp_buffer) {
+    view.samples = NULL;
+    view.size = 0;
     this->updateIndexNextIteration();
     const std::runtime_error *error = NULL;
-    double* dbl_ptr = NULL;
     try {
-        while((this->temp_buffer_stop < this->ind_stop) && !this->finished) {
+        // Nothing is decoded past the time stop or the last selected window
+        bool in_range = ((this->ind_last_sample < 0) || (this->ind_first_sample + this->ind_stop <= this->ind_last_sample))
+                        && ((this->nb_windows_max < 0) || (this->iteration < this->nb_windows_max));
+        while(in_range && (this->temp_buffer_stop < this->ind_stop) && !this->finished) {
             // Decode one frame
             while((av_audio_fifo_size(this->pAudioFifo) < this->WS_resampled) && !this->finished) {
                 this->DecodeOneAudioFrame();
-                if (this->data_present) {
+                if (this->data_present && this->AlignFirstFrameAfterSeek()) {
                     this->ConvertAndStoreOneFrame();
+                    this->SkipSamplesBeforeFirstSample();
                 }
             }
-            // Fill Output frame as much as possible
+            // Move the samples of the FIFO at the end of the buffer as much as possible
             while (av_audio_fifo_size(this->pAudioFifo) >= this->WS_resampled) {
-                if (av_audio_fifo_read(this->pAudioFifo, (void **)this->pOutputFrame->data, this->WS_resampled) < this->WS_resampled) {
-                    this->FreeOutputFrame();
+                size_t size = temp_buffer.size();
+                if (size + this->WS_resampled > temp_buffer.capacity()) {
+                    this->nb_allocations++;
+                }
+                temp_buffer.resize(size + this->WS_resampled);
+                void *samples_ptr = (void*)(temp_buffer.data() + size);
+                if (av_audio_fifo_read(this->pAudioFifo, &samples_ptr, this->WS_resampled) < this->WS_resampled) {
                     throw std::runtime_error("Could not read data from FIFO");
                 }
-                // Update audio buffer vector and update stop index
-                dbl_ptr = (double*)*(this->pOutputFrame->data);
-                // std::vector<double> tempbuf(dbl_ptr, dbl_ptr + this->WS_resampled);
-                this->temp_buffer.insert( this->temp_buffer.end(), dbl_ptr, dbl_ptr + this->WS_resampled);
                 this->temp_buffer_stop += this->WS_resampled;
             }
         }
-        if(this->temp_buffer_stop >= this->ind_stop) {
-            // Translate the vector to the first element
-            auto first = this->temp_buffer.begin() + (this->ind_start - this->temp_buffer_start);
-            this->temp_buffer.erase(this->temp_buffer.begin(), first);
-            this->temp_buffer_start = this->ind_start;
-            // Extract the part of the buffer to sent
-            buffer.assign(this->temp_buffer.begin(), this->temp_buffer.begin() + this->WS_resampled);
+        if(in_range && (this->temp_buffer_stop >= this->ind_stop)) {
+            // The samples before the window are only removed once they fill half of the buffer:
+            // one move of the remaining samples for many windows instead of one per window
+            int64_t nb_samples_used = this->ind_start - this->temp_buffer_start;
+            if((nb_samples_used > 0) && (2 * (size_t)nb_samples_used >= temp_buffer.size())) {
+                temp_buffer.erase(temp_buffer.begin(), temp_buffer.begin() + nb_samples_used);
+                this->temp_buffer_start = this->ind_start;
+            }
+            // The window is given in place
+            view.samples = temp_buffer.data() + (this->ind_start - this->temp_buffer_start);
+            view.size = (size_t)this->WS_resampled;
             return true;
         }/* else {
             // Finished
@@ -490,9 +832,10 @@ bool FFmpegAudioReader::getNextBuffer(std::vector<double> & buffer) {
     }
     // Free memory
     this->FreeInputFrame();
+    this->FreeConvertedSamples();
+    this->FreePacket();
     this->FreeAudioFifo();
     this->FreeSwrCtx();
-    this->FreeOutputFrame();
     this->FreeCodecCtx();
     this->FreeFormatCtx();
     // If error != NULL then an error occured
@@ -503,6 +846,20 @@ bool FFmpegAudioReader::getNextBuffer(std::vector<double> & buffer) {
 }
 
 
+FFmpegAudioReader::FFmpegAudioReader(const FFmpegAudioReader & other) : AudioReader(other) {
+    // Copy of the streams information only (no probing of the file), the copy has its own extraction
+    this->InitMembers();
+    this->input = other.input;
+}
+
+
 FFmpegAudioReader::~FFmpegAudioReader() {
     // Destructor
+    this->FreeInputFrame();
+    this->FreeConvertedSamples();
+    this->FreePacket();
+    this->FreeAudioFifo();
+    this->FreeSwrCtx();
+    this->FreeCodecCtx();
+    this->FreeFormatCtx();
 }
@@ -1,12 +1,16 @@
 #include "McLeodPitchExtractorMethod.hpp"
+#include "simd_kernels.hpp"
 #include <limits>
 #include <numeric>
 #include <algorithm>
+#include <cmath>
 
 McLeodPitchExtractorMethod::McLeodPitchExtractorMethod(const McLeodParameters & parameters/*=DEFAULT_MC_LEOD_PARAMETERS*/) {
     this->cutoff = parameters.cutoff;
     this->small_cutoff = parameters.small_cutoff;
     this->lower_pitch_cutoff = parameters.lower_pitch_cutoff;
+    this->upper_pitch_cutoff = parameters.upper_pitch_cutoff;
+    this->nsdf_method = parameters.nsdf_method;
 }
 
 
@@ -14,6 +18,8 @@ McLeodPitchExtractorMethod::McLeodPitchExtractorMethod(const McLeodPitchExtracto
     this->cutoff = extractor.cutoff;
     this->small_cutoff = extractor.small_cutoff;
     this->lower_pitch_cutoff = extractor.lower_pitch_cutoff;
+    this->upper_pitch_cutoff = extractor.upper_pitch_cutoff;
+    this->nsdf_method = extractor.nsdf_method;
 }
 
 
@@ -37,6 +43,16 @@ void McLeodPitchExtractorMethod::setLowerPitch(double lower_pitch_cutoff) {
 }
 
 
+void McLeodPitchExtractorMethod::setUpperPitch(double upper_pitch_cutoff) {
+    this->upper_pitch_cutoff = upper_pitch_cutoff;
+}
+
+
+void McLeodPitchExtractorMethod::setNsdfMethod(NsdfMethod nsdf_method) {
+    this->nsdf_method = nsdf_method;
+}
+
+
 double McLeodPitchExtractorMethod::getCutoff() const {
     return cutoff;
 }
@@ -52,17 +68,164 @@ double McLeodPitchExtractorMethod::getLowerPitch() const {
 }
 
 
-void McLeodPitchExtractorMethod::normalizedSquareDifference(const std::vector<double> & audio_buffer, std::vector<double> & nsdf) const {
-    // Calculate Mean value
-    double mean_buffer = std::accumulate(audio_buffer.begin(), audio_buffer.end(), 0.0) / audio_buffer.size();
-    nsdf = std::vector<double>(audio_buffer.size());
+double McLeodPitchExtractorMethod::getUpperPitch() const {
+    return upper_pitch_cutoff;
+}
+
+
+NsdfMethod McLeodPitchExtractorMethod::getNsdfMethod() const {
+    return nsdf_method;
+}
+
+
+// Workspace of the calling thread
+static McLeodWorkspace & get_thread_workspace() {
+    static thread_local McLeodWorkspace workspace;
+    return workspace;
+}
+
+
+// Signal minus its mean value
+static void removeMean(const double * audio_buffer, size_t N, std::vector<double> & signal) {
+    double mean_buffer = kernel_sum(audio_buffer, N) / (double)N;
+    signal.resize(N);
+    kernel_subtract(audio_buffer, mean_buffer, signal.data(), N);
+}
+
+
+static void removeMean(const float * audio_buffer, size_t N, std::vector<float> & signal) {
+    double mean_buffer = kernel_sum(audio_buffer, N) / (double)N;
+    signal.resize(N);
+    kernel_subtract(audio_buffer, (float)mean_buffer, signal.data(), N);
+}
+
+
+// Single precision buffer with a double precision output (FFT)
+static void removeMean(const float * audio_buffer, size_t N, std::vector<double> & signal) {
+    double mean_buffer = kernel_sum(audio_buffer, N) / (double)N;
+    signal.resize(N);
+    for(size_t i = 0; i < N; i++) {
+        signal[i] = (double)audio_buffer[i] - mean_buffer;
+    }
+}
+
+
+// Signal minus its mean value in the precision of the input buffer
+static const double * centeredSignal(const double * audio_buffer, size_t N, McLeodWorkspace & workspace) {
+    removeMean(audio_buffer, N, workspace.signal);
+    return workspace.signal.data();
+}
+
+
+static const float * centeredSignal(const float * audio_buffer, size_t N, McLeodWorkspace & workspace) {
+    removeMean(audio_buffer, N, workspace.signal_float);
+    return workspace.signal_float.data();
+}
+
+
+template<typename T>
+void McLeodPitchExtractorMethod::normalizedSquareDifference(const T * audio_buffer, size_t N, McLeodWorkspace & workspace) const {
+    const T * signal = centeredSignal(audio_buffer, N, workspace);
+    std::vector<double> & nsdf = workspace.nsdf;
+    nsdf.assign(N, 0.0);
     double maxval;
     double acf = 0.0;
-    for(size_t tau = 0; tau < audio_buffer.size(); tau++) {
-        acf = 0.0;
-        for(size_t i = 0; i < audio_buffer.size() - tau; i++) {
-            acf += (audio_buffer[i] - mean_buffer) * (audio_buffer[i + tau] - mean_buffer);
+    for(size_t tau = 0; tau < N; tau++) {
+        acf = kernel_dot(signal, signal + tau, N - tau);
+        if(tau == 0) {
+            maxval = acf;
         }
+        nsdf[tau] = acf / maxval;
+    }
+}
+
+
+std::shared_ptr<const RealFFT> McLeodPitchExtractorMethod::getFFT(uint64_t size) const {
+    std::lock_guard<std::mutex> lock(this->fft_mutex);
+    if(!this->fft || (this->fft->getSize() != size)) {
+        this->fft = std::make_shared<const RealFFT>(size);
+    }
+    return this->fft;
+}
+
+
+const RealFFT & McLeodPitchExtractorMethod::getFFT(uint64_t size, McLeodWorkspace & workspace) const {
+    if(!workspace.fft || (workspace.fft->getSize() != size)) {
+        workspace.fft = this->getFFT(size);
+    }
+    return *workspace.fft;
+}
+
+
+void McLeodPitchExtractorMethod::autocorrelationFFT(const std::vector<double> & signal, std::vector<double> & acf, McLeodWorkspace & workspace) const {
+    // Zero-padding to at least twice the signal size so the circular autocorrelation equals the linear one
+    const RealFFT & fft = this->getFFT(std::max((uint64_t)2, next_power_of_two(2 * signal.size())), workspace);
+    // Autocorrelation is the inverse transform of the power spectrum
+    fft.forward(signal, workspace.spectrum);
+    for(auto & bin : workspace.spectrum) {
+        bin = std::norm(bin);
+    }
+    fft.inverse(workspace.spectrum, acf);
+    acf.resize(signal.size());
+}
+
+
+template<typename T>
+void McLeodPitchExtractorMethod::normalizedSquareDifferenceFFT(const T * audio_buffer, size_t N, McLeodWorkspace & workspace) const {
+    removeMean(audio_buffer, N, workspace.signal);
+    std::vector<double> & nsdf = workspace.nsdf;
+    this->autocorrelationFFT(workspace.signal, nsdf, workspace);
+    double maxval = nsdf[0];
+    for(auto & value : nsdf) {
+        value = value / maxval;
+    }
+}
+
+
+template<typename T>
+void McLeodPitchExtractorMethod::normalizedSquareDifferenceIncremental(const T * audio_buffer, size_t N, size_t hop_size,
+                                                                       McLeodStreamState & stream, McLeodWorkspace & workspace) const {
+    // The previous window must be the current one shifted by hop_size samples
+    bool incremental = (stream.buffer.size() == N) && (stream.acf.size() == N) &&
+                       (hop_size < N) && (stream.nb_updates < MC_LEOD_STREAM_REFRESH_PERIOD) &&
+                       std::equal(audio_buffer, audio_buffer + (N - hop_size), stream.buffer.begin() + (std::ptrdiff_t)hop_size);
+    if(incremental) {
+        // Raw lag products: remove the pairs leaving the window, add the pairs entering it
+        // (the previous window is kept in double precision)
+        const double * previous = stream.buffer.data();
+        const T * current = audio_buffer;
+        for(size_t tau = 0; tau < N; tau++) {
+            double removed = kernel_dot(previous, previous + tau, std::min(hop_size, N - tau));
+            size_t k_start = std::max(N - hop_size, tau);
+            double added = kernel_dot(current + k_start - tau, current + k_start, N - k_start);
+            stream.acf[tau] += added - removed;
+        }
+        stream.nb_updates++;
+        // Rounding errors are relative to the loudest window since the last exact computation
+        incremental = stream.acf[0] >= MC_LEOD_STREAM_PRECISION_RATIO * stream.max_energy;
+    }
+    stream.buffer.assign(audio_buffer, audio_buffer + N);
+    if(!incremental) {
+        this->autocorrelationFFT(stream.buffer, stream.acf, workspace);
+        stream.nb_updates = 0;
+        stream.max_energy = 0.0;
+    }
+    stream.max_energy = std::max(stream.max_energy, stream.acf[0]);
+    // Mean removal from the prefix sums of the window:
+    // sum((x[i] - m)(x[i+tau] - m)) = sum(x[i]x[i+tau]) - m(sum(x[0:N-tau]) + sum(x[tau:N])) + (N-tau)m^2
+    std::vector<double> & prefix_sum = workspace.prefix_sum;
+    prefix_sum.assign(N + 1, 0.0);
+    for(size_t i = 0; i < N; i++) {
+        prefix_sum[i + 1] = prefix_sum[i] + audio_buffer[i];
+    }
+    double mean_buffer = prefix_sum[N] / (double)N;
+    std::vector<double> & nsdf = workspace.nsdf;
+    nsdf.assign(N, 0.0);
+    double maxval = 0.0;
+    for(size_t tau = 0; tau < N; tau++) {
+        double acf = stream.acf[tau]
+                     - mean_buffer * (prefix_sum[N - tau] + prefix_sum[N] - prefix_sum[tau])
+                     + (double)(N - tau) * mean_buffer * mean_buffer;
         if(tau == 0) {
             maxval = acf;
         }
@@ -70,19 +233,115 @@ void McLeodPitchExtractorMethod::normalizedSquareDifference(const std::vector<do
     }
 }
 
+
 double McLeodPitchExtractorMethod::get_pitch(const std::vector<double> & audio_buffer, double sample_rate_hz) const {
-    // 0. Clear previous results (Is this faster than initializing a list
-    // again and again?)
-    std::vector<unsigned int> max_positions;
-    std::vector<double> period_estimates;
-    std::vector<double> amp_estimates;
-    std::vector<double> nsdf;
+    return this->getPitch(audio_buffer.data(), audio_buffer.size(), sample_rate_hz, get_thread_workspace());
+}
+
+
+double McLeodPitchExtractorMethod::get_pitch(const std::vector<float> & audio_buffer, double sample_rate_hz) const {
+    return this->getPitch(audio_buffer.data(), audio_buffer.size(), sample_rate_hz, get_thread_workspace());
+}
+
+
+double McLeodPitchExtractorMethod::get_pitch(const std::vector<double> & audio_buffer, double sample_rate_hz, McLeodWorkspace & workspace) const {
+    return this->getPitch(audio_buffer.data(), audio_buffer.size(), sample_rate_hz, workspace);
+}
+
+
+double McLeodPitchExtractorMethod::get_pitch(const std::vector<float> & audio_buffer, double sample_rate_hz, McLeodWorkspace & workspace) const {
+    return this->getPitch(audio_buffer.data(), audio_buffer.size(), sample_rate_hz, workspace);
+}
+
+
+void McLeodPitchExtractorMethod::get_nsdf(const std::vector<double> & audio_buffer, std::vector<double> & nsdf) const {
+    McLeodWorkspace & workspace = get_thread_workspace();
+    this->computeNsdf(audio_buffer.data(), audio_buffer.size(), workspace);
+    nsdf = workspace.nsdf;
+}
+
+
+template<typename T>
+void McLeodPitchExtractorMethod::computeNsdf(const T * audio_buffer, size_t buffer_size, McLeodWorkspace & workspace) const {
+    // Normalized square difference for each Tau value
+    if(this->nsdf_method == NsdfMethod::DIRECT) {
+        this->normalizedSquareDifference(audio_buffer, buffer_size, workspace);
+    } else {
+        // Without the previous window, the incremental method falls back to the FFT
+        this->normalizedSquareDifferenceFFT(audio_buffer, buffer_size, workspace);
+    }
+}
+
+
+template<typename T>
+double McLeodPitchExtractorMethod::getPitch(const T * audio_buffer, size_t buffer_size, double sample_rate_hz, McLeodWorkspace & workspace) const {
+    // 1. Calculate the normalized square difference for each Tau value.
+    this->computeNsdf(audio_buffer, buffer_size, workspace);
+    return this->pitchFromNsdf(workspace.nsdf, buffer_size, sample_rate_hz, workspace);
+}
+
+
+void McLeodPitchExtractorMethod::get_pitches(const WindowBatch<double> & batch, double sample_rate_hz, double * pitches_hz, double * energies) const {
+    this->getPitches(batch, sample_rate_hz, pitches_hz, energies, get_thread_workspace());
+}
+
+
+void McLeodPitchExtractorMethod::get_pitches(const WindowBatch<float> & batch, double sample_rate_hz, double * pitches_hz, double * energies) const {
+    this->getPitches(batch, sample_rate_hz, pitches_hz, energies, get_thread_workspace());
+}
+
+
+void McLeodPitchExtractorMethod::get_pitches(const WindowBatch<double> & batch, double sample_rate_hz, double * pitches_hz, double * energies, McLeodWorkspace & workspace) const {
+    this->getPitches(batch, sample_rate_hz, pitches_hz, energies, workspace);
+}
+
+
+void McLeodPitchExtractorMethod::get_pitches(const WindowBatch<float> & batch, double sample_rate_hz, double * pitches_hz, double * energies, McLeodWorkspace & workspace) const {
+    this->getPitches(batch, sample_rate_hz, pitches_hz, energies, workspace);
+}
+
+
+template<typename T>
+void McLeodPitchExtractorMethod::getPitches(const WindowBatch<T> & batch, double sample_rate_hz, double * pitches_hz, double * energies, McLeodWorkspace & workspace) const {
+    size_t N = batch.window_size;
+    // Hop from the window before the batch, whose lag products may still be in the workspace
+    size_t hop_size = N;
+    if(batch.first_window > 0) {
+        hop_size = (size_t)(get_window_start(batch.hop_size, batch.first_window) - get_window_start(batch.hop_size, batch.first_window - 1));
+    }
+    size_t previous_start = 0;
+    for(size_t k = 0; k < batch.nb_windows; k++) {
+        size_t start = batch.getWindowStart(k);
+        const T * window = batch.samples + start;
+        if(k > 0) {
+            hop_size = start - previous_start;
+        }
+        if(this->nsdf_method == NsdfMethod::DIRECT) {
+            this->normalizedSquareDifference(window, N, workspace);
+        } else if(this->nsdf_method == NsdfMethod::FFT) {
+            this->normalizedSquareDifferenceFFT(window, N, workspace);
+        } else {
+            this->normalizedSquareDifferenceIncremental(window, N, hop_size, workspace.stream, workspace);
+        }
+        previous_start = start;
+        pitches_hz[k] = this->pitchFromNsdf(workspace.nsdf, N, sample_rate_hz, workspace);
+        energies[k] = getEnergy(window, N);
+    }
+}
+
+
+double McLeodPitchExtractorMethod::pitchFromNsdf(const std::vector<double> & nsdf, size_t buffer_size, double sample_rate_hz, McLeodWorkspace & workspace) const {
+    // 0. Clear previous results (the capacity of the workspace is kept)
+    std::vector<unsigned int> & max_positions = workspace.max_positions;
+    std::vector<double> & period_estimates = workspace.period_estimates;
+    std::vector<double> & amp_estimates = workspace.amp_estimates;
+    max_positions.clear();
+    period_estimates.clear();
+    amp_estimates.clear();
     double turningpoint_x;
     double turningpoint_y;
-    // 1. Calculate the normalized square difference for each Tau value.
-    this->normalizedSquareDifference(audio_buffer, nsdf);
     // 2. Peak picking time: time to pick some peaks.
-    this->peakPicking(nsdf, max_positions);
+    this->peakPicking(nsdf, buffer_size, max_positions);
     double highest_amplitude = -std::numeric_limits<double>::infinity();
     for(unsigned int i = 0; i < max_positions.size(); i++) {
         unsigned int tau = max_positions[i];
@@ -114,7 +373,8 @@ double McLeodPitchExtractorMethod::get_pitch(const std::vector<double> & audio_b
         }
         double period = period_estimates[periodIndex];
         double pitch_estimate = sample_rate_hz / period;
-        if(pitch_estimate > this->lower_pitch_cutoff) {
+        bool below_upper_cutoff = (this->upper_pitch_cutoff <= 0) || (pitch_estimate < this->upper_pitch_cutoff);
+        if((pitch_estimate > this->lower_pitch_cutoff) && below_upper_cutoff) {
             pitch = pitch_estimate;
         }
     }
@@ -139,11 +399,12 @@ void McLeodPitchExtractorMethod::parabolicInterpolation(unsigned int tau, const
 }
 
 
-void McLeodPitchExtractorMethod::peakPicking(const std::vector<double> & nsdf, std::vector<unsigned int> & max_positions) const {
+void McLeodPitchExtractorMethod::peakPicking(const std::vector<double> & nsdf, size_t buffer_size, std::vector<unsigned int> & max_positions) const {
     unsigned int pos = 0;
     unsigned int cur_max_pos = 0;
-    // find the first negative zero crossing
-    while(pos < (nsdf.size() - 1) / 3 && nsdf[pos] > 0) {
+    // find the first negative zero crossing (in the first third of the lag range)
+    size_t first_crossing_max = std::min((buffer_size - 1) / 3, nsdf.size() - 1);
+    while(pos < first_crossing_max && nsdf[pos] > 0) {
         pos++;
     }
     // loop over all the values below zero
@@ -2,6 +2,10 @@
 #include <exception>
 #include <chrono>
 #include <future>
+#include <functional>
+#include <deque>
+#include <limits>
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 #include "PitchDetector.hpp"
@@ -15,6 +19,8 @@ PitchDetector::PitchDetector(AudioReader *audio_reader, PitchExtractorMethod *pi
     this->audio_reader = audio_reader;
     this->pitch_extractor = pitch_extractor;
     this->f0_hz = F0_HZ;
+    this->nb_threads = 0;
+    this->nb_segments = 1;
 }
 
 
@@ -23,30 +29,38 @@ PitchDetector::~PitchDetector() {
 }
 
 
-double PitchDetector::getEnergy(const std::vector<double> & audio_buffer) const {
-    // audio_buffer must be between -1 and 1 if I want consistent result whatever input format
-    double energy = 0;
-    for(const auto & sample : audio_buffer) {
-        energy += sample * sample;
+void PitchDetector::setNumberOfThreads(unsigned int nb_threads) {
+    this->nb_threads = nb_threads;
+}
+
+
+unsigned int PitchDetector::getNumberOfThreads() const {
+    if(this->nb_threads == 0) {
+        return std::max((unsigned int)1, CONCURRENT_THREADS_SUPPORTED);
     }
-    energy = energy / audio_buffer.size();
-    return energy;
+    return this->nb_threads;
 }
 
 
-template<typename T>
-bool future_is_ready(std::future<T>& t){
-    return t.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+void PitchDetector::setNumberOfSegments(unsigned int nb_segments) {
+    this->nb_segments = nb_segments;
 }
 
-void remove_futures_ready(std::vector<std::future<void>> & async_ret) {
-    for(int64_t k = async_ret.size()-1; k >= 0; k--) {
-        if(future_is_ready(async_ret[k])) {
-            async_ret.erase(async_ret.begin() + k);
-        }
+
+unsigned int PitchDetector::getNumberOfSegments() const {
+    return std::max((unsigned int)1, this->nb_segments);
+}
+
+
+ThreadPool & PitchDetector::getThreadPool() {
+    if(!this->thread_pool || (this->thread_pool->getNumberOfThreads() != this->getNumberOfThreads())) {
+        unsigned int nb_threads = this->getNumberOfThreads();
+        this->thread_pool.reset(new ThreadPool(nb_threads, PITCH_DETECTOR_QUEUED_BATCHES_PER_THREAD * nb_threads));
     }
+    return *this->thread_pool;
 }
 
+
 PitchResult PitchDetector::perform( std::atomic<float> * progress,
                                     const AudioReaderParameters & audio_parameters/*=DEFAULT_AUDIO_READER_PARAMETERS*/,
                                     unsigned int audio_stream_ind/*=0*/,
@@ -56,44 +70,202 @@ PitchResult PitchDetector::perform( std::atomic<float> * progress,
     this->tempresult.period_s = audio_parameters.period_s;
     this->tempresult.f0_hz = this->f0_hz;
     this->tempresult.offset_s = (timestart_s < 0.0) ? 0.0 : timestart_s;
-    this->tempresult.pitch_st.clear();
-    this->tempresult.energy.clear();
     this->audio_reader->initExtraction(audio_parameters, audio_stream_ind, timestart_s, timestop_s);
     double dst_sample_rate_hz = (double)this->audio_reader->getOutputSampleRate();
+    // Duration of the extracted time range (progress)
     double duration_s = this->audio_reader->getStreams()[audio_stream_ind].duration_s;
-    double nan = std::numeric_limits<double>::quiet_NaN();
-    // Temporary variables
-    std::vector<double> temp_buffer;
-    unsigned int nb_thread_free = std::max((unsigned int)1, CONCURRENT_THREADS_SUPPORTED);
-    std::vector<std::future<void>> async_ret;
-    uint64_t k = 0;
-    while(this->audio_reader->getNextBuffer(temp_buffer)) {
-        this->tempresult.pitch_st.push_back(nan);
-        this->tempresult.energy.push_back(nan);
-        while(async_ret.size() >= CONCURRENT_THREADS_SUPPORTED) {
-            remove_futures_ready(async_ret);
+    if((timestop_s >= 0) && (timestop_s < duration_s)) {
+        duration_s = timestop_s;
+    }
+    duration_s -= this->tempresult.offset_s;
+    // Segments: the windows are split between several readers of the file, decoded concurrently
+    uint64_t nb_buffers = this->audio_reader->getExpectedNumberOfBuffers(audio_stream_ind);
+    unsigned int nb_segments = this->getNumberOfSegments();
+    std::vector<std::unique_ptr<AudioReader>> segment_readers;
+    std::vector<AudioReader*> readers(1, this->audio_reader);
+    std::vector<uint64_t> first_windows(1, 0);
+    if((nb_segments > 1) && (nb_buffers >= nb_segments * PITCH_DETECTOR_BATCH_SIZE)) {
+        for(unsigned int s = 1; s < nb_segments; s++) {
+            std::unique_ptr<AudioReader> reader = this->audio_reader->clone();
+            if(!reader) {
+                // Segments not supported by the reader
+                break;
+            }
+            segment_readers.push_back(std::move(reader));
         }
-        async_ret.push_back(std::async(std::launch::async, &PitchDetector::processBuffer, this, k, dst_sample_rate_hz, temp_buffer));
-        k += 1;
-        if(progress->load() < 0) {
-            while(async_ret.size() >= CONCURRENT_THREADS_SUPPORTED) {
-                remove_futures_ready(async_ret);
+        if(segment_readers.size() == nb_segments - 1) {
+            for(unsigned int s = 1; s < nb_segments; s++) {
+                first_windows.push_back((nb_buffers * s) / nb_segments);
+            }
+            // The last segment goes until the end of the extraction
+            this->audio_reader->selectWindows(0, (int64_t)first_windows[1]);
+            for(unsigned int s = 1; s < nb_segments; s++) {
+                AudioReader * reader = segment_readers[s - 1].get();
+                reader->initExtraction(audio_parameters, audio_stream_ind, timestart_s, timestop_s);
+                int64_t nb_windows = (s + 1 < nb_segments) ? (int64_t)(first_windows[s + 1] - first_windows[s]) : -1;
+                reader->selectWindows(first_windows[s], nb_windows);
+                readers.push_back(reader);
             }
-            throw std::runtime_error("Process cancel by the user");
         }
-        *progress = (audio_parameters.period_s * this->tempresult.pitch_st.size() * 100.0) / duration_s;
+    }
+    if(audio_parameters.sample_format == SampleFormat::FLOAT) {
+        this->processBuffers<float>(progress, audio_parameters, readers, first_windows, nb_buffers, dst_sample_rate_hz, duration_s);
+    } else {
+        this->processBuffers<double>(progress, audio_parameters, readers, first_windows, nb_buffers, dst_sample_rate_hz, duration_s);
     }
     *progress = 100.0;
     return this->tempresult;
 }
 
 
-void PitchDetector::processBuffer(size_t index, double sample_rate_hz, const std::vector<double> buffer) {
-    double pitch_hz = this->pitch_extractor->get_pitch(buffer, sample_rate_hz);
-    double pitch_st = convert_freq_to_tone(pitch_hz, this->tempresult.f0_hz);
-    double energy = this->getEnergy(buffer);
-    this->tempresult.energy[index] = energy;
-    this->tempresult.pitch_st[index] = pitch_st;
+template<typename T>
+void PitchDetector::processBuffers(std::atomic<float> * progress, const AudioReaderParameters & audio_parameters,
+                                   const std::vector<AudioReader*> & readers, const std::vector<uint64_t> & first_windows,
+                                   uint64_t nb_buffers, double dst_sample_rate_hz, double duration_s) {
+    double hop_size = audio_parameters.period_s * dst_sample_rate_hz;
+    // Batches in progress: the workers write directly in the outputs, which are sized from the number of
+    // samples of the stream and only resized when no batch is in progress (no relocation under a worker)
+    ThreadPool & thread_pool = this->getThreadPool();
+    std::deque<std::future<void>> async_ret;
+    double nan = std::numeric_limits<double>::quiet_NaN();
+    this->tempresult.pitch_st.assign(nb_buffers, nan);
+    this->tempresult.energy.assign(nb_buffers, nan);
+    // Decoding stage, one thread per reader (the readers are only used by the decoding threads from here),
+    // the last decoding thread to finish closes the queue
+    BoundedQueue<PitchBatch<T>> batches(PITCH_DETECTOR_DECODED_BATCHES * readers.size());
+    std::vector<std::exception_ptr> decoding_errors(readers.size());
+    std::atomic<size_t> nb_decoders(readers.size());
+    std::vector<std::thread> decoders;
+    for(size_t s = 0; s < readers.size(); s++) {
+        decoders.push_back(std::thread([&, s]() {
+            try {
+                this->decodeBatches<T>(*readers[s], hop_size, first_windows[s], batches);
+            } catch(...) {
+                decoding_errors[s] = std::current_exception();
+                batches.close();
+            }
+            if(--nb_decoders == 0) {
+                batches.close();
+            }
+        }));
+    }
+    uint64_t nb_windows = 0;
+    uint64_t nb_windows_done = 0;
+    auto collect_oldest = [&]() {
+        std::future<void> oldest = std::move(async_ret.front());
+        async_ret.pop_front();
+        oldest.get();
+    };
+    try {
+        PitchBatch<T> batch;
+        while(batches.pop(batch)) {
+            // Forward the errors of the finished batches
+            while(!async_ret.empty() && (async_ret.front().wait_for(std::chrono::seconds(0)) == std::future_status::ready)) {
+                collect_oldest();
+            }
+            uint64_t stop_window = batch.first_window + batch.nb_windows;
+            if(stop_window > this->tempresult.pitch_st.size()) {
+                // More buffers than expected: grow when the workers are done
+                while(!async_ret.empty()) {
+                    collect_oldest();
+                }
+                size_t new_size = std::max(2 * this->tempresult.pitch_st.size(), (size_t)stop_window);
+                this->tempresult.pitch_st.resize(new_size, nan);
+                this->tempresult.energy.resize(new_size, nan);
+            }
+            double * pitches_st = this->tempresult.pitch_st.data() + batch.first_window;
+            double * energies = this->tempresult.energy.data() + batch.first_window;
+            nb_windows = std::max(nb_windows, stop_window);
+            nb_windows_done += batch.nb_windows;
+            // Waits while the queue of the workers is full
+            async_ret.push_back(thread_pool.submit(std::bind(&PitchDetector::processBatch<T>, this, std::move(batch),
+                                                             hop_size, dst_sample_rate_hz, pitches_st, energies)));
+            if(progress->load() < 0) {
+                throw std::runtime_error("Process cancel by the user");
+            }
+            *progress = (float)((audio_parameters.period_s * (double)nb_windows_done * 100.0) / duration_s);
+        }
+        while(!async_ret.empty()) {
+            collect_oldest();
+        }
+    } catch(...) {
+        // The decoders and the workers must be done before leaving
+        batches.close();
+        for(auto & decoder : decoders) {
+            decoder.join();
+        }
+        for(auto & batch_result : async_ret) {
+            batch_result.wait();
+        }
+        throw;
+    }
+    for(auto & decoder : decoders) {
+        decoder.join();
+    }
+    for(auto & decoding_error : decoding_errors) {
+        if(decoding_error) {
+            std::rethrow_exception(decoding_error);
+        }
+    }
+    // Fewer buffers than expected
+    this->tempresult.pitch_st.resize(nb_windows);
+    this->tempresult.energy.resize(nb_windows);
+}
+
+
+template<typename T>
+void PitchDetector::decodeBatches(AudioReader & reader, double hop_size, uint64_t first_window, BoundedQueue<PitchBatch<T>> & batches) {
+    BufferView<T> temp_buffer;
+    // The overlapping buffers are merged back into a contiguous block of samples
+    PitchBatch<T> batch = {0, 0, 0, std::vector<T>()};
+    int64_t block_start = 0;
+    uint64_t k = first_window;
+    // Returns false if the queue has been closed by the consumer (error or cancellation)
+    auto push_batch = [&]() {
+        bool pushed = batches.push(std::move(batch));
+        batch.samples = std::vector<T>();
+        batch.nb_windows = 0;
+        return pushed;
+    };
+    while(reader.getNextBufferView(temp_buffer)) {
+        int64_t start = get_window_start(hop_size, k);
+        int64_t block_stop = block_start + (int64_t)batch.samples.size();
+        if((batch.nb_windows > 0) && (start > block_stop)) {
+            // Gap between the windows (hop larger than the window)
+            if(!push_batch()) {
+                return;
+            }
+        }
+        if(batch.nb_windows == 0) {
+            batch.samples.assign(temp_buffer.samples, temp_buffer.samples + temp_buffer.size);
+            batch.first_window = k;
+            batch.window_size = temp_buffer.size;
+            block_start = start;
+        } else {
+            batch.samples.insert(batch.samples.end(), temp_buffer.samples + (block_stop - start), temp_buffer.samples + temp_buffer.size);
+        }
+        batch.nb_windows++;
+        k += 1;
+        if(batch.nb_windows == PITCH_DETECTOR_BATCH_SIZE) {
+            if(!push_batch()) {
+                return;
+            }
+        }
+    }
+    if(batch.nb_windows > 0) {
+        push_batch();
+    }
+}
+
+
+template<typename T>
+void PitchDetector::processBatch(const PitchBatch<T> & batch, double hop_size, double sample_rate_hz,
+                                 double * pitches_st, double * energies) const {
+    WindowBatch<T> windows = {batch.samples.data(), batch.window_size, hop_size, batch.first_window, batch.nb_windows};
+    this->pitch_extractor->get_pitches(windows, sample_rate_hz, pitches_st, energies);
+    for(size_t k = 0; k < batch.nb_windows; k++) {
+        pitches_st[k] = convert_freq_to_tone(pitches_st[k], this->tempresult.f0_hz);
+    }
 }
 
 // #include <cmath>
@@ -1,4 +1,5 @@
 #include "PitchExtractorMethod.hpp"
+#include "simd_kernels.hpp"
 
 
 PitchExtractorMethod::PitchExtractorMethod() {
@@ -8,4 +9,42 @@ PitchExtractorMethod::PitchExtractorMethod() {
 
 PitchExtractorMethod::~PitchExtractorMethod() {
     // Destructor
-}
\ No newline at end of file
+}
+
+
+double PitchExtractorMethod::get_pitch(const std::vector<float> & audio_buffer, double sample_rate_hz) const {
+    return this->get_pitch(std::vector<double>(audio_buffer.begin(), audio_buffer.end()), sample_rate_hz);
+}
+
+
+template<typename T>
+static void get_pitches_per_window(const PitchExtractorMethod & method, const WindowBatch<T> & batch, double sample_rate_hz, double * pitches_hz, double * energies) {
+    std::vector<T> buffer;
+    for(size_t k = 0; k < batch.nb_windows; k++) {
+        const T * window = batch.samples + batch.getWindowStart(k);
+        buffer.assign(window, window + batch.window_size);
+        pitches_hz[k] = method.get_pitch(buffer, sample_rate_hz);
+        energies[k] = PitchExtractorMethod::getEnergy(window, batch.window_size);
+    }
+}
+
+
+void PitchExtractorMethod::get_pitches(const WindowBatch<double> & batch, double sample_rate_hz, double * pitches_hz, double * energies) const {
+    get_pitches_per_window(*this, batch, sample_rate_hz, pitches_hz, energies);
+}
+
+
+void PitchExtractorMethod::get_pitches(const WindowBatch<float> & batch, double sample_rate_hz, double * pitches_hz, double * energies) const {
+    get_pitches_per_window(*this, batch, sample_rate_hz, pitches_hz, energies);
+}
+
+
+double PitchExtractorMethod::getEnergy(const double * audio_buffer, size_t size) {
+    // audio_buffer must be between -1 and 1 if I want consistent result whatever input format
+    return kernel_sum_squares(audio_buffer, size) / (double)size;
+}
+
+
+double PitchExtractorMethod::getEnergy(const float * audio_buffer, size_t size) {
+    return kernel_sum_squares(audio_buffer, size) / (double)size;
+}
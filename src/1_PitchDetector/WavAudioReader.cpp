@@ -0,0 +1,561 @@
+#include "WavAudioReader.hpp"
+#include "FFmpegAudioReader.hpp"
+#include "common_tools.hpp"
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+
+class MappedFile {
+public:
+    // Constructor
+    MappedFile(const std::string & filepath);
+    // Destructor
+    ~MappedFile();
+    const uint8_t * data;
+    size_t size;
+private:
+    MappedFile(const MappedFile &);
+    MappedFile & operator=(const MappedFile &);
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#endif
+};
+
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string & filepath) {
+    // Constructor
+    this->data = NULL;
+    this->size = 0;
+    this->mapping = NULL;
+    this->file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                             FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if(this->file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Could not open file");
+    }
+    LARGE_INTEGER file_size;
+    if(!GetFileSizeEx(this->file, &file_size) || (file_size.QuadPart == 0)) {
+        CloseHandle(this->file);
+        throw std::runtime_error("Could not map file");
+    }
+    this->mapping = CreateFileMappingA(this->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if(this->mapping == NULL) {
+        CloseHandle(this->file);
+        throw std::runtime_error("Could not map file");
+    }
+    this->data = (const uint8_t*)MapViewOfFile(this->mapping, FILE_MAP_READ, 0, 0, 0);
+    if(this->data == NULL) {
+        CloseHandle(this->mapping);
+        CloseHandle(this->file);
+        throw std::runtime_error("Could not map file");
+    }
+    this->size = (size_t)file_size.QuadPart;
+}
+
+
+MappedFile::~MappedFile() {
+    // Destructor
+    UnmapViewOfFile(this->data);
+    CloseHandle(this->mapping);
+    CloseHandle(this->file);
+}
+#else
+MappedFile::MappedFile(const std::string & filepath) {
+    // Constructor
+    this->data = NULL;
+    this->size = 0;
+    int fd = open(filepath.c_str(), O_RDONLY);
+    if(fd < 0) {
+        throw std::runtime_error("Could not open file");
+    }
+    struct stat file_stat;
+    if((fstat(fd, &file_stat) < 0) || (file_stat.st_size <= 0)) {
+        close(fd);
+        throw std::runtime_error("Could not map file");
+    }
+    void * data = mmap(NULL, (size_t)file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping stays valid after closing the file
+    close(fd);
+    if(data == MAP_FAILED) {
+        throw std::runtime_error("Could not map file");
+    }
+    // The windows are read in order
+    madvise(data, (size_t)file_stat.st_size, MADV_SEQUENTIAL);
+    this->data = (const uint8_t*)data;
+    this->size = (size_t)file_stat.st_size;
+}
+
+
+MappedFile::~MappedFile() {
+    // Destructor
+    munmap((void*)this->data, this->size);
+}
+#endif
+
+
+/* PRIVATE FUNCTIONS */
+/*********************/
+static uint16_t read_u16(const uint8_t * bytes) {
+    return (uint16_t)(bytes[0] | (bytes[1] << 8));
+}
+
+
+static uint32_t read_u32(const uint8_t * bytes) {
+    return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+
+// Sample in [-1, 1[
+static double read_sample(const uint8_t * bytes, WavSampleFormat format) {
+    switch(format) {
+        case WavSampleFormat::PCM16:
+            return (double)(int16_t)read_u16(bytes) / 32768.0;
+        case WavSampleFormat::PCM24: {
+            int32_t value = (int32_t)(bytes[0] | (bytes[1] << 8) | (bytes[2] << 16));
+            if(value & 0x800000) {
+                value -= 0x1000000;
+            }
+            return (double)value / 8388608.0;
+        }
+        case WavSampleFormat::PCM32:
+            return (double)(int32_t)read_u32(bytes) / 2147483648.0;
+        case WavSampleFormat::FLOAT32: {
+            float value;
+            std::memcpy(&value, bytes, sizeof(float));
+            return (double)value;
+        }
+        case WavSampleFormat::FLOAT64: {
+            double value;
+            std::memcpy(&value, bytes, sizeof(double));
+            return value;
+        }
+    }
+    return 0.0;
+}
+
+
+static int64_t greatest_common_divisor(int64_t a, int64_t b) {
+    while(b != 0) {
+        int64_t r = a % b;
+        a = b;
+        b = r;
+    }
+    return a;
+}
+
+
+// Modified Bessel function of the first kind of order 0 (Kaiser window)
+static double bessel_i0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    for(int k = 1; term > 1e-12 * sum; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+
+void WavAudioReader::parseHeader() {
+    const uint8_t * data = this->mapped_file->data;
+    size_t size = this->mapped_file->size;
+    if((size < 12) || (std::memcmp(data, "RIFF", 4) != 0) || (std::memcmp(data + 8, "WAVE", 4) != 0)) {
+        throw std::runtime_error("Unsupported WAV file");
+    }
+    bool fmt_found = false;
+    bool data_found = false;
+    uint16_t audio_format = 0;
+    uint16_t bits_per_sample = 0;
+    uint16_t block_align = 0;
+    uint32_t sample_rate_hz = 0;
+    size_t data_size = 0;
+    size_t offset = 12;
+    while((offset + 8 <= size) && !data_found) {
+        const uint8_t * chunk = data + offset;
+        size_t chunk_size = read_u32(chunk + 4);
+        if(std::memcmp(chunk, "fmt ", 4) == 0) {
+            if((chunk_size < 16) || (offset + 8 + 16 > size)) {
+                throw std::runtime_error("Unsupported WAV file");
+            }
+            audio_format = read_u16(chunk + 8);
+            this->nb_channels = read_u16(chunk + 10);
+            sample_rate_hz = read_u32(chunk + 12);
+            block_align = read_u16(chunk + 20);
+            bits_per_sample = read_u16(chunk + 22);
+            // WAVE_FORMAT_EXTENSIBLE: format given by the sub-format
+            if((audio_format == 0xFFFE) && (chunk_size >= 40) && (offset + 8 + 26 <= size)) {
+                audio_format = read_u16(chunk + 8 + 24);
+            }
+            fmt_found = true;
+        } else if(std::memcmp(chunk, "data", 4) == 0) {
+            this->data_offset = offset + 8;
+            // The size of the chunk can be unknown (streamed file)
+            data_size = std::min(chunk_size, size - this->data_offset);
+            data_found = true;
+        }
+        // Chunks are aligned on 2 bytes
+        offset += 8 + chunk_size + (chunk_size & 1);
+    }
+    if(!fmt_found || !data_found || (this->nb_channels == 0) || (sample_rate_hz == 0)) {
+        throw std::runtime_error("Unsupported WAV file");
+    }
+    std::string format;
+    if((audio_format == 1) && (bits_per_sample == 16)) {
+        this->wav_sample_format = WavSampleFormat::PCM16;
+        format = "pcm_s16le";
+    } else if((audio_format == 1) && (bits_per_sample == 24)) {
+        this->wav_sample_format = WavSampleFormat::PCM24;
+        format = "pcm_s24le";
+    } else if((audio_format == 1) && (bits_per_sample == 32)) {
+        this->wav_sample_format = WavSampleFormat::PCM32;
+        format = "pcm_s32le";
+    } else if((audio_format == 3) && (bits_per_sample == 32)) {
+        this->wav_sample_format = WavSampleFormat::FLOAT32;
+        format = "pcm_f32le";
+    } else if((audio_format == 3) && (bits_per_sample == 64)) {
+        this->wav_sample_format = WavSampleFormat::FLOAT64;
+        format = "pcm_f64le";
+    } else {
+        throw std::runtime_error("Unsupported WAV file");
+    }
+    this->bytes_per_sample = bits_per_sample / 8;
+    if(block_align != this->nb_channels * this->bytes_per_sample) {
+        throw std::runtime_error("Unsupported WAV file");
+    }
+    this->nb_frames = (int64_t)(data_size / block_align);
+    // Single audio stream
+    AudioStream stream;
+    stream.ind_stream = 0;
+    stream.format = format;
+    stream.nb_channels = this->nb_channels;
+    stream.nb_samples = (unsigned long int)this->nb_frames;
+    stream.sample_rate_hz = sample_rate_hz;
+    stream.duration_s = (double)this->nb_frames / (double)sample_rate_hz;
+    stream.bit_rate = (unsigned long int)sample_rate_hz * block_align * 8;
+    this->streams.push_back(stream);
+}
+
+
+template<typename T>
+void WavAudioReader::convertFrames(int64_t first_frame, int64_t nb_frames, T * samples) const {
+    size_t frame_size = this->nb_channels * this->bytes_per_sample;
+    const uint8_t * frame = this->mapped_file->data + this->data_offset + (size_t)first_frame * frame_size;
+    double scale = 1.0 / (double)this->nb_channels;
+    for(int64_t k = 0; k < nb_frames; k++) {
+        double sum = 0.0;
+        for(unsigned int c = 0; c < this->nb_channels; c++) {
+            sum += read_sample(frame + c * this->bytes_per_sample, this->wav_sample_format);
+        }
+        samples[k] = (T)(sum * scale);
+        frame += frame_size;
+    }
+}
+
+
+void WavAudioReader::initResampling(int64_t src_rate_hz, int64_t dst_rate_hz) {
+    int64_t rates_gcd = greatest_common_divisor(src_rate_hz, dst_rate_hz);
+    int64_t up_factor = dst_rate_hz / rates_gcd;
+    int64_t down_factor = src_rate_hz / rates_gcd;
+    if((up_factor == this->up_factor) && (down_factor == this->down_factor)) {
+        return;
+    }
+    this->up_factor = up_factor;
+    this->down_factor = down_factor;
+    this->filter.clear();
+    this->filter_half_size = 0;
+    if((up_factor == 1) && (down_factor == 1)) {
+        return;
+    }
+    // Frames per period of the lowest rate
+    double scale = std::max(1.0, (double)down_factor / (double)up_factor);
+    double bandwidth = WAV_RESAMPLING_CUTOFF / scale;
+    double half_width = (double)WAV_RESAMPLING_FILTER_SIZE / 2.0 * scale;
+    this->filter_half_size = (int64_t)floor(half_width) + 1;
+    size_t nb_taps = 2 * (size_t)this->filter_half_size;
+    this->filter.assign((size_t)up_factor * nb_taps, 0.0);
+    double window_norm = bessel_i0(WAV_RESAMPLING_KAISER_BETA);
+    for(int64_t p = 0; p < up_factor; p++) {
+        double * taps = this->filter.data() + (size_t)p * nb_taps;
+        double sum = 0.0;
+        for(size_t k = 0; k < nb_taps; k++) {
+            // Distance between the position of the sample and the frame of the tap
+            double tau = (double)p / (double)up_factor + (double)(this->filter_half_size - 1) - (double)k;
+            if(std::abs(tau) >= half_width) {
+                continue;
+            }
+            double x = M_PI * bandwidth * tau;
+            double sinc = (x == 0.0) ? 1.0 : sin(x) / x;
+            double r = tau / half_width;
+            taps[k] = sinc * bessel_i0(WAV_RESAMPLING_KAISER_BETA * sqrt(1.0 - r * r)) / window_norm;
+            sum += taps[k];
+        }
+        // Unit gain at 0 Hz for each phase
+        for(size_t k = 0; k < nb_taps; k++) {
+            taps[k] /= sum;
+        }
+    }
+}
+
+
+template<typename T>
+void WavAudioReader::convertSamples(int64_t first_sample, int64_t nb_samples, T * samples) {
+    if((this->up_factor == 1) && (this->down_factor == 1)) {
+        this->convertFrames(first_sample, nb_samples, samples);
+        return;
+    }
+    // Downmixed frames under the filter of the samples (zero outside of the file)
+    int64_t frame_start = first_sample * this->down_factor / this->up_factor - this->filter_half_size + 1;
+    int64_t frame_stop = (first_sample + nb_samples - 1) * this->down_factor / this->up_factor + this->filter_half_size + 1;
+    this->resampling_input.assign((size_t)(frame_stop - frame_start), 0.0);
+    int64_t convert_start = std::max(frame_start, (int64_t)0);
+    int64_t convert_stop = std::min(frame_stop, this->nb_frames);
+    if(convert_stop > convert_start) {
+        this->convertFrames(convert_start, convert_stop - convert_start,
+                            this->resampling_input.data() + (convert_start - frame_start));
+    }
+    size_t nb_taps = 2 * (size_t)this->filter_half_size;
+    for(int64_t n = 0; n < nb_samples; n++) {
+        int64_t position = (first_sample + n) * this->down_factor;
+        int64_t frame = position / this->up_factor;
+        const double * taps = this->filter.data() + (size_t)(position % this->up_factor) * nb_taps;
+        const double * input = this->resampling_input.data() + (frame - this->filter_half_size + 1 - frame_start);
+        double sum = 0.0;
+        for(size_t k = 0; k < nb_taps; k++) {
+            sum += taps[k] * input[k];
+        }
+        samples[n] = (T)sum;
+    }
+}
+
+
+template<typename T>
+bool WavAudioReader::extractNextBuffer(BufferView<T> & view, std::vector<T> & temp_buffer) {
+    view.samples = NULL;
+    view.size = 0;
+    this->iteration += 1;
+    if((this->nb_windows_max >= 0) && (this->iteration >= this->nb_windows_max)) {
+        return false;
+    }
+    // Windows of the grid of the whole extraction, relative to the first selected one
+    double hop_size = this->dst_period_s * (double)this->dst_rate_hz;
+    int64_t ind_start = this->ind_first_sample - this->window_offset
+                        + get_window_start(hop_size, this->first_window + (uint64_t)this->iteration);
+    int64_t ind_stop = ind_start + this->WS;
+    if(ind_stop > this->ind_last_sample) {
+        return false;
+    }
+    int64_t temp_buffer_stop = this->temp_buffer_start + (int64_t)temp_buffer.size();
+    if(ind_start > temp_buffer_stop) {
+        // Gap between the windows (hop larger than the window)
+        temp_buffer.clear();
+        this->temp_buffer_start = ind_start;
+        temp_buffer_stop = ind_start;
+    }
+    // The samples before the window are only removed once they fill half of the buffer
+    int64_t nb_samples_used = ind_start - this->temp_buffer_start;
+    if((nb_samples_used > 0) && (2 * (size_t)nb_samples_used >= temp_buffer.size())) {
+        temp_buffer.erase(temp_buffer.begin(), temp_buffer.begin() + nb_samples_used);
+        this->temp_buffer_start = ind_start;
+    }
+    // Convert the new samples of the window only
+    if(ind_stop > temp_buffer_stop) {
+        size_t size = temp_buffer.size();
+        temp_buffer.resize(size + (size_t)(ind_stop - temp_buffer_stop));
+        this->convertSamples(temp_buffer_stop, ind_stop - temp_buffer_stop, temp_buffer.data() + size);
+    }
+    view.samples = temp_buffer.data() + (ind_start - this->temp_buffer_start);
+    view.size = (size_t)this->WS;
+    return true;
+}
+
+
+/* PUBLIC FUNCTIONS */
+/********************/
+WavAudioReader::WavAudioReader(std::string filepath) : AudioReader(filepath) {
+    // Constructor
+    this->data_offset = 0;
+    this->nb_frames = 0;
+    this->nb_channels = 0;
+    this->bytes_per_sample = 0;
+    this->wav_sample_format = WavSampleFormat::PCM16;
+    this->WS = 0;
+    this->iteration = -1;
+    this->ind_first_sample = 0;
+    this->ind_last_sample = 0;
+    this->first_window = 0;
+    this->window_offset = 0;
+    this->nb_windows_max = -1;
+    this->temp_buffer_start = 0;
+    this->up_factor = 1;
+    this->down_factor = 1;
+    this->filter_half_size = 0;
+    this->use_resampling_reader = false;
+    this->mapped_file = std::make_shared<MappedFile>(filepath);
+    this->parseHeader();
+}
+
+
+WavAudioReader::WavAudioReader(const WavAudioReader & other) : AudioReader(other) {
+    // Copy of the mapping and of the header, the copy has its own extraction
+    this->mapped_file = other.mapped_file;
+    this->data_offset = other.data_offset;
+    this->nb_frames = other.nb_frames;
+    this->nb_channels = other.nb_channels;
+    this->bytes_per_sample = other.bytes_per_sample;
+    this->wav_sample_format = other.wav_sample_format;
+    this->up_factor = other.up_factor;
+    this->down_factor = other.down_factor;
+    this->filter_half_size = other.filter_half_size;
+    this->filter = other.filter;
+    if(other.resampling_reader) {
+        this->resampling_reader = other.resampling_reader->clone();
+    }
+    this->use_resampling_reader = false;
+    this->WS = 0;
+    this->iteration = -1;
+    this->ind_first_sample = 0;
+    this->ind_last_sample = 0;
+    this->first_window = 0;
+    this->window_offset = 0;
+    this->nb_windows_max = -1;
+    this->temp_buffer_start = 0;
+}
+
+
+WavAudioReader::~WavAudioReader() {
+    // Destructor
+}
+
+
+void WavAudioReader::initExtraction( const AudioReaderParameters & parameters/*=DEFAULT_AUDIO_READER_PARAMETERS*/,
+                                     unsigned int audio_stream_ind/*=0*/,
+                                     double timestart_s/*=-1.0*/,
+                                     double timestop_s/*=-1.0*/
+                                     ) {
+    if((timestop_s >= 0) && (timestop_s <= std::max(timestart_s, 0.0))) {
+        throw std::runtime_error("Invalid time range");
+    }
+    if(audio_stream_ind >= this->streams.size()) {
+        throw std::runtime_error("Invalid input index");
+    }
+    this->dst_rate_hz = this->getExtractionSampleRate(parameters, audio_stream_ind);
+    this->dst_period_s = parameters.period_s;
+    this->dst_windowsize_s = parameters.windowstimesize_s;
+    this->dst_sample_format = parameters.sample_format;
+    this->dst_timestart_s = timestart_s;
+    this->dst_timestop_s = timestop_s;
+    int64_t src_rate_hz = this->streams[audio_stream_ind].sample_rate_hz;
+    this->use_resampling_reader = (this->dst_rate_hz / greatest_common_divisor(src_rate_hz, this->dst_rate_hz)
+                                   > WAV_RESAMPLING_MAX_PHASES);
+    if(this->use_resampling_reader) {
+        // Resampling by FFmpeg, the file is only probed by the first of these extractions
+        AudioReaderParameters resampling_parameters = parameters;
+        resampling_parameters.resample_rate_hz = this->dst_rate_hz;
+        if(!this->resampling_reader) {
+            this->resampling_reader.reset(new FFmpegAudioReader(this->filepath));
+        }
+        this->resampling_reader->initExtraction(resampling_parameters, audio_stream_ind, timestart_s, timestop_s);
+        return;
+    }
+    this->initResampling(src_rate_hz, this->dst_rate_hz);
+    // Size of the windows
+    this->WS = (int64_t)round(this->dst_windowsize_s * (double)this->dst_rate_hz);
+    // Samples of the time range
+    this->ind_first_sample = (int64_t)round(std::max(timestart_s, 0.0) * (double)this->dst_rate_hz);
+    this->ind_last_sample = this->nb_frames * this->up_factor / this->down_factor;
+    if(timestop_s >= 0) {
+        this->ind_last_sample = std::min(this->ind_last_sample, (int64_t)round(timestop_s * (double)this->dst_rate_hz));
+    }
+    this->first_window = 0;
+    this->window_offset = 0;
+    this->nb_windows_max = -1;
+    // Index of the first audio buffer to get
+    this->iteration = -1;
+    this->temp_buffer_start = this->ind_first_sample;
+    this->temp_buffer.clear();
+    this->temp_buffer_float.clear();
+}
+
+
+void WavAudioReader::selectWindows(uint64_t first_window, int64_t nb_windows/*=-1*/) {
+    if(this->use_resampling_reader) {
+        this->resampling_reader->selectWindows(first_window, nb_windows);
+        return;
+    }
+    if((this->WS == 0) || (this->iteration >= 0)) {
+        throw std::runtime_error("Windows must be selected between initExtraction() and the first buffer");
+    }
+    double hop_size = this->dst_period_s * (double)this->dst_rate_hz;
+    int64_t ind_range_start = (int64_t)round(std::max(this->dst_timestart_s, 0.0) * (double)this->dst_rate_hz);
+    this->first_window = first_window;
+    this->window_offset = get_window_start(hop_size, first_window);
+    this->nb_windows_max = nb_windows;
+    this->ind_first_sample = ind_range_start + this->window_offset;
+    this->temp_buffer_start = this->ind_first_sample;
+    this->temp_buffer.clear();
+    this->temp_buffer_float.clear();
+}
+
+
+std::unique_ptr<AudioReader> WavAudioReader::clone() const {
+    return std::unique_ptr<AudioReader>(new WavAudioReader(*this));
+}
+
+
+WavSampleFormat WavAudioReader::getWavSampleFormat() const {
+    return this->wav_sample_format;
+}
+
+
+bool WavAudioReader::getNextBuffer(std::vector<double> & buffer) {
+    BufferView<double> view;
+    bool ret = this->getNextBufferView(view);
+    buffer.assign(view.samples, view.samples + view.size);
+    return ret;
+}
+
+
+bool WavAudioReader::getNextBuffer(std::vector<float> & buffer) {
+    BufferView<float> view;
+    bool ret = this->getNextBufferView(view);
+    buffer.assign(view.samples, view.samples + view.size);
+    return ret;
+}
+
+
+bool WavAudioReader::getNextBufferView(BufferView<double> & view) {
+    if(this->use_resampling_reader) {
+        return this->resampling_reader->getNextBufferView(view);
+    }
+    if(this->dst_sample_format != SampleFormat::DOUBLE) {
+        throw std::runtime_error("Buffer type does not match the sample format of the extraction");
+    }
+    return this->extractNextBuffer(view, this->temp_buffer);
+}
+
+
+bool WavAudioReader::getNextBufferView(BufferView<float> & view) {
+    if(this->use_resampling_reader) {
+        return this->resampling_reader->getNextBufferView(view);
+    }
+    if(this->dst_sample_format != SampleFormat::FLOAT) {
+        throw std::runtime_error("Buffer type does not match the sample format of the extraction");
+    }
+    return this->extractNextBuffer(view, this->temp_buffer_float);
+}
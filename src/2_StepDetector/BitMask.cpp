@@ -0,0 +1,214 @@
+#include "BitMask.hpp"
+#include <stdexcept>
+#ifdef _MSC_VER
+    #include <intrin.h>
+#endif
+
+
+static const size_t WORD_BITS = 64;
+
+
+// Index of the lowest bit set (word != 0)
+static inline unsigned int count_trailing_zeros(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned int)__builtin_ctzll(word);
+#elif defined(_MSC_VER) && defined(_WIN64)
+    unsigned long index;
+    _BitScanForward64(&index, word);
+    return (unsigned int)index;
+#else
+    unsigned int index = 0;
+    while((word & 1) == 0) {
+        word >>= 1;
+        index++;
+    }
+    return index;
+#endif
+}
+
+
+static inline unsigned int population_count(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned int)__builtin_popcountll(word);
+#else
+    unsigned int count = 0;
+    for(; word != 0; word &= word - 1) {
+        count++;
+    }
+    return count;
+#endif
+}
+
+
+BitMask::BitMask(size_t size/*=0*/, bool value/*=false*/) {
+    // Constructor
+    this->assign(size, value);
+}
+
+
+BitMask::BitMask(const std::vector<bool> & values) {
+    // Constructor
+    this->assign(values.size(), false);
+    for(size_t k = 0; k < values.size(); k++) {
+        if(values[k]) {
+            this->words[k / WORD_BITS] |= (uint64_t)1 << (k % WORD_BITS);
+        }
+    }
+}
+
+
+size_t BitMask::size() const {
+    return this->nb_bits;
+}
+
+
+bool BitMask::empty() const {
+    return this->nb_bits == 0;
+}
+
+
+bool BitMask::get(size_t index) const {
+    return ((this->words[index / WORD_BITS] >> (index % WORD_BITS)) & 1) != 0;
+}
+
+
+void BitMask::set(size_t index, bool value) {
+    uint64_t bit = (uint64_t)1 << (index % WORD_BITS);
+    if(value) {
+        this->words[index / WORD_BITS] |= bit;
+    } else {
+        this->words[index / WORD_BITS] &= ~bit;
+    }
+}
+
+
+void BitMask::assign(size_t size, bool value) {
+    this->nb_bits = size;
+    this->words.assign((size + WORD_BITS - 1) / WORD_BITS, value ? ~(uint64_t)0 : 0);
+    this->clearPadding();
+}
+
+
+std::vector<bool> BitMask::toVector() const {
+    std::vector<bool> values(this->nb_bits, false);
+    for(size_t k = 0; k < this->nb_bits; k++) {
+        values[k] = this->get(k);
+    }
+    return values;
+}
+
+
+size_t BitMask::count() const {
+    size_t count = 0;
+    for(const auto & word : this->words) {
+        count += population_count(word);
+    }
+    return count;
+}
+
+
+void BitMask::checkSize(const BitMask & other) const {
+    if(other.nb_bits != this->nb_bits) {
+        throw std::runtime_error("Input mask sizes are not equal");
+    }
+}
+
+
+void BitMask::clearPadding() {
+    size_t nb_used_bits = this->nb_bits % WORD_BITS;
+    if(nb_used_bits != 0) {
+        this->words.back() &= ((uint64_t)1 << nb_used_bits) - 1;
+    }
+}
+
+
+BitMask & BitMask::operator|=(const BitMask & other) {
+    this->checkSize(other);
+    for(size_t k = 0; k < this->words.size(); k++) {
+        this->words[k] |= other.words[k];
+    }
+    return *this;
+}
+
+
+BitMask & BitMask::operator&=(const BitMask & other) {
+    this->checkSize(other);
+    for(size_t k = 0; k < this->words.size(); k++) {
+        this->words[k] &= other.words[k];
+    }
+    return *this;
+}
+
+
+void BitMask::flip() {
+    for(auto & word : this->words) {
+        word = ~word;
+    }
+    this->clearPadding();
+}
+
+
+BitMask BitMask::operator|(const BitMask & other) const {
+    BitMask result(*this);
+    result |= other;
+    return result;
+}
+
+
+BitMask BitMask::operator&(const BitMask & other) const {
+    BitMask result(*this);
+    result &= other;
+    return result;
+}
+
+
+BitMask BitMask::operator~() const {
+    BitMask result(*this);
+    result.flip();
+    return result;
+}
+
+
+bool BitMask::operator==(const BitMask & other) const {
+    return (this->nb_bits == other.nb_bits) && (this->words == other.words);
+}
+
+
+bool BitMask::operator!=(const BitMask & other) const {
+    return !(*this == other);
+}
+
+
+size_t BitMask::findNext(size_t index, bool value) const {
+    if(index >= this->nb_bits) {
+        return this->nb_bits;
+    }
+    size_t ind_word = index / WORD_BITS;
+    // Bits equal to value from index in the first word
+    uint64_t word = value ? this->words[ind_word] : ~this->words[ind_word];
+    word &= ~(uint64_t)0 << (index % WORD_BITS);
+    while(word == 0) {
+        ind_word++;
+        if(ind_word == this->words.size()) {
+            return this->nb_bits;
+        }
+        word = value ? this->words[ind_word] : ~this->words[ind_word];
+    }
+    // The padding bits of ~word are set: stop at the end of the mask
+    size_t found = ind_word * WORD_BITS + count_trailing_zeros(word);
+    return (found < this->nb_bits) ? found : this->nb_bits;
+}
+
+
+std::vector<std::pair<uint64_t, uint64_t>> BitMask::getRuns(bool value, uint64_t min_length/*=0*/) const {
+    std::vector<std::pair<uint64_t, uint64_t>> runs;
+    size_t start = this->findNext(0, value);
+    while(start < this->nb_bits) {
+        size_t stop = this->findNext(start, !value);
+        if((stop - start) >= min_length) {
+            runs.push_back(std::make_pair((uint64_t)start, (uint64_t)stop));
+        }
+        start = this->findNext(stop, value);
+    }
+    return runs;
+}
@@ -35,7 +35,7 @@ HistogramStepDetector::~HistogramStepDetector() {
 }
 
 
-Histogram HistogramStepDetector::getHistogram(const std::vector<double> & pitch_buffer) const {
+void HistogramStepDetector::getHistogram(const std::vector<double> & pitch_buffer, Histogram & histo) const {
     if(pitch_buffer.empty()) {
         throw std::runtime_error("Input vector of pitchs is empty");
     }
@@ -49,17 +49,17 @@ Histogram HistogramStepDetector::getHistogram(const std::vector<double> & pitch_
     }
     double min_st = nb_step_min * this->histogram_step_st;
     double max_st = nb_step_max * this->histogram_step_st;
-    Histogram result = histogram(pitch_buffer, nb_step_max - nb_step_min, min_st, max_st);
-    return result;
+    histogram(pitch_buffer, nb_step_max - nb_step_min, min_st, max_st, histo);
 }
 
 
-void HistogramStepDetector::smoothHistogram(Histogram & histo) const {
+void HistogramStepDetector::smoothHistogram(Histogram & histo) {
     if(histo.data.empty()) {
         throw std::runtime_error("Input signal is empty");
     }
-    std::vector<double> histo_convolved = convolve(histo.data, this->gaussian_shape);
-    histo.data.assign(histo_convolved.begin(), histo_convolved.end());
+    convolve(histo.data, this->gaussian_shape, this->smoothing_buffer);
+    // The previous data becomes the buffer of the next smoothing
+    histo.data.swap(this->smoothing_buffer);
 }
 
 
@@ -226,7 +226,8 @@ std::vector<std::pair<uint64_t, double>> HistogramStepDetector::formatOutput(con
 
 std::vector<std::pair<uint64_t, double>> HistogramStepDetector::recoverSteps(const std::vector<double> & pitch_buffer, const StepParameters & parameters/*=DEFAULT_STEP_PARAMETERS*/) {
     // Get the classic histogram
-    Histogram histo = this->getHistogram(pitch_buffer);
+    Histogram & histo = this->histogram_buffer;
+    this->getHistogram(pitch_buffer, histo);
     // Smoothing the histogram using gaussian function
     this->smoothHistogram(histo);
     // Extract all the local maximum indexes
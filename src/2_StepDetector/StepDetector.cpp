@@ -11,6 +11,7 @@
 
 
 StepDetector::StepDetector(const PitchResult & pitch_result, const std::vector<bool> & mask/*={}*/) {
+    this->auto_energy_bandwidth = -1.0;
     // Pitch array
     if(pitch_result.pitch_st.empty()) {
         throw std::runtime_error("Pitch array cannot be empty");
@@ -34,7 +35,7 @@ StepDetector::StepDetector(const PitchResult & pitch_result, const std::vector<b
         if(mask.size() != this->pitch_st.size()) {
             throw std::runtime_error("Mask array size is not the same as pitch array size");
         }
-        this->mask = mask;
+        this->mask = BitMask(mask);
     }
     // Energy array
     if(!pitch_result.energy.empty()){
@@ -58,17 +59,17 @@ std::vector<double> StepDetector::getPitch() const {
 
 
 std::vector<bool> StepDetector::getMask() const{
-    return this->mask;
+    return this->mask.toVector();
 }
 
 
 std::vector<bool> StepDetector::getPitchMask() const {
-    return this->pitch_mask;
+    return this->pitch_mask.toVector();
 }
 
 
 std::vector<bool> StepDetector::getEnergyMask() const {
-    return this->energy_mask;
+    return this->energy_mask.toVector();
 }
 
 
@@ -105,7 +106,7 @@ void StepDetector::setMask(const std::vector<bool> & mask) {
     if(mask.size() != this->pitch_st.size()) {
         throw std::runtime_error("Input vector sizes are not equal");
     }
-    this->mask = mask;
+    this->mask = BitMask(mask);
 }
 
 
@@ -116,7 +117,7 @@ void StepDetector::setEnergyMask(const std::vector<bool> & mask) {
     if(mask.size() != this->energy_mask.size()) {
         throw std::runtime_error("Input energy masks sizes are not equal");
     }
-    this->energy_mask = mask;
+    this->energy_mask = BitMask(mask);
 }
 
 
@@ -124,7 +125,7 @@ void StepDetector::setPitchMask(const std::vector<bool> & mask) {
     if(mask.size() != this->pitch_mask.size()) {
         throw std::runtime_error("Input pitch masks sizes are not equal");
     }
-    this->pitch_mask = mask;
+    this->pitch_mask = BitMask(mask);
 }
 
 
@@ -147,7 +148,7 @@ void StepDetector::setPitch(const std::vector<std::pair<size_t, double>> & index
 
 void StepDetector::setMask(const std::vector<std::pair<size_t, bool>> & indexes_and_values) {
     for(auto const& index_and_value: indexes_and_values) {
-        this->mask[index_and_value.first] = index_and_value.second;
+        this->mask.set(index_and_value.first, index_and_value.second);
     }
 }
 
@@ -161,29 +162,30 @@ void StepDetector::setEnergy(const std::vector<std::pair<size_t, double>> & inde
 
 
 void StepDetector::resetPitchMask() {
-    this->pitch_mask = std::vector<bool>(this->pitch_st.size(), false);
+    this->pitch_mask.assign(this->pitch_st.size(), false);
     for(size_t k = 0; k < this->pitch_st.size(); k++) {
         if((this->pitch_st[k] < 0) || std::isnan(this->pitch_st[k])) {
-            this->pitch_mask[k] = true;
+            this->pitch_mask.set(k, true);
         }
     }
 }
 
 
 void StepDetector::resetEnergyMask() {
-    this->energy_mask = std::vector<bool>(this->energy.size(), false);
+    this->energy_mask.assign(this->energy.size(), false);
     for(size_t k = 0; k < this->energy.size(); k++) {
         if((this->energy[k] < 0) || std::isnan(this->energy[k])) {
-            this->energy_mask[k] = true;
+            this->energy_mask.set(k, true);
         }
     }
 }
 
 
-std::vector<bool> StepDetector::getCombinedMasks() const {
-    std::vector<bool> temp_mask = mask_logical_or(this->mask, this->pitch_mask);
+BitMask StepDetector::getCombinedMasks() const {
+    BitMask temp_mask(this->mask);
+    temp_mask |= this->pitch_mask;
     if(this->hasEnergy()) {
-        temp_mask = mask_logical_or(temp_mask, this->energy_mask);
+        temp_mask |= this->energy_mask;
     }
     return temp_mask;
 }
@@ -194,8 +196,7 @@ void StepDetector::maskThroughEnergyHysteresis(double threshold_off, double thre
         throw std::runtime_error("Energy is not provided");
     }
     HysteresisThreshold thresholding(threshold_off, threshold_on, true);
-    std::vector<bool> mask = thresholding.perform(this->energy);
-    this->setEnergyMask(mask_logical_or(mask, this->energy_mask));
+    this->energy_mask |= BitMask(thresholding.perform(this->energy));
 }
 
 
@@ -204,17 +205,16 @@ void StepDetector::maskThroughEnergyCumulativeSum(double threshold_min, double c
         throw std::runtime_error("Energy is not provided");
     }
     CumulativeSumThreshold thresholding(threshold_min, cumsum_min, true);
-    std::vector<bool> mask = thresholding.perform(this->energy);
-    this->setEnergyMask(mask_logical_or(mask, this->energy_mask));
+    this->energy_mask |= BitMask(thresholding.perform(this->energy));
 }
 
 
 void StepDetector::maskThroughToneHeight(double tone_min, double tone_max) {
-    std::vector<bool> mask(this->pitch_st.size(), false);
     for(size_t k = 0; k < this->pitch_st.size(); k++) {
-        mask[k] = (this->pitch_st[k] < tone_min) || (this->pitch_st[k] > tone_max);
+        if((this->pitch_st[k] < tone_min) || (this->pitch_st[k] > tone_max)) {
+            this->pitch_mask.set(k, true);
+        }
     }
-    this->setPitchMask(mask_logical_or(mask, this->pitch_mask));
 }
 
 
@@ -246,7 +246,7 @@ void StepDetector::medianFilterEnergy(double window_size_s) {
 ///////////////////////////////////////////////////////
 
 
-void StepDetector::maskAutoEnergy() {
+void StepDetector::maskAutoEnergy(double bandwidth/*=-1.0*/) {
     if(!this->hasEnergy()) {
         throw std::runtime_error("Energy is not provided");
     }
@@ -254,22 +254,50 @@ void StepDetector::maskAutoEnergy() {
     for(const auto & sample: this->energy) {
         energy_db.push_back(10.0 * log10(sample));
     }
-    uint64_t bins = 1000;
-    std::vector<double> points = get_histogram_points(energy_db, bins);
-
-    double gaussiankdebandwidth = 0.1;
-    GaussianKde density(energy_db, gaussiankdebandwidth);
-    std::vector<double> histo = density.evaluate(points);
-    std::vector<uint64_t> local_maxs = extract_local_min_max(histo, false, true);
-    while(local_maxs.size() > 2) {
-        gaussiankdebandwidth += 0.01;
-        density = GaussianKde(energy_db, gaussiankdebandwidth);
+    std::vector<double> points = get_histogram_points(energy_db, AUTO_ENERGY_BINS);
+    // The covariance and the bins of the energy are computed once for all the bandwidths
+    GaussianKde density(energy_db, AUTO_ENERGY_BANDWIDTH_MIN, KdeMethod::BINNED);
+    std::vector<double> histo;
+    std::vector<uint64_t> local_maxs;
+    auto evaluate = [&](double gaussiankdebandwidth) {
+        density.setBandwidth(gaussiankdebandwidth);
         histo = density.evaluate(points);
         local_maxs = extract_local_min_max(histo, false, true);
+        return local_maxs.size();
+    };
+    if((bandwidth <= 0) || (evaluate(bandwidth) != 2)) {
+        // The number of maxima decreases when the bandwidth increases: upper bound of the number of
+        // steps by doubling, then bisection
+        auto bandwidth_of_step = [](uint64_t step) {
+            return AUTO_ENERGY_BANDWIDTH_MIN + AUTO_ENERGY_BANDWIDTH_STEP * (double)step;
+        };
+        uint64_t step_max = 0;
+        if(evaluate(bandwidth_of_step(0)) > 2) {
+            uint64_t step_min = 0;
+            step_max = 1;
+            while(evaluate(bandwidth_of_step(step_max)) > 2) {
+                step_min = step_max;
+                step_max *= 2;
+                if(step_max >= AUTO_ENERGY_MAX_STEPS) {
+                    throw std::runtime_error("Auto masking energy failed");
+                }
+            }
+            while(step_max - step_min > 1) {
+                uint64_t step = (step_min + step_max) / 2;
+                if(evaluate(bandwidth_of_step(step)) > 2) {
+                    step_min = step;
+                } else {
+                    step_max = step;
+                }
+            }
+        }
+        bandwidth = bandwidth_of_step(step_max);
+        evaluate(bandwidth);
     }
     if(local_maxs.size() != 2) {
         throw std::runtime_error("Auto masking energy failed");
     }
+    this->auto_energy_bandwidth = bandwidth;
     uint64_t ind_max_noise = local_maxs[0];
     uint64_t ind_max_signal = local_maxs[1];
     auto it_min = std::min_element(histo.begin() + ind_max_noise, histo.begin() + ind_max_signal);
@@ -281,44 +309,19 @@ void StepDetector::maskAutoEnergy() {
 }
 
 
+double StepDetector::getAutoEnergyBandwidth() const {
+    return this->auto_energy_bandwidth;
+}
+
+
 void StepDetector::detectGroupsOfNotes(double min_group_size_s/*=50e-3*/) {
     if(min_group_size_s < 0) {
         throw std::runtime_error("Minimum length of note cannot be a negative number");
     }
     // Minimum number of samples
     uint64_t NbSamplesMin = (uint64_t)(round(min_group_size_s / this->period_s));
-    // Reset the indexes of detected groups of notes
-    this->groups.clear();
-    std::pair<uint64_t, uint64_t> temp_indexes;
-    bool group_detected = false;
-    // Get the mask resulting for all combined masks
-    std::vector<bool> total_mask = this->getCombinedMasks();
-    // Initial conditions
-    if(total_mask[0] == false) {
-        group_detected = true;
-        temp_indexes.first = 0;
-    }
-    for(size_t k = 1; k < total_mask.size(); k++) {
-        if(!total_mask[k] && !group_detected) {
-            group_detected = true;
-            temp_indexes.first = k;
-        }
-        if(total_mask[k] && group_detected) {
-            if((k - temp_indexes.first) >= NbSamplesMin) {
-                temp_indexes.second = k;
-                this->groups.push_back(temp_indexes);
-            }
-            group_detected = false;
-        }
-        // Condition for the end of the mask is a group has been detected
-        if((k == (total_mask.size() -1)) && group_detected) {
-            if((k + 1 - temp_indexes.first) >= NbSamplesMin) {
-                temp_indexes.second = k + 1;
-                this->groups.push_back(temp_indexes);
-            }
-        }
-    }
-
+    // Groups of notes: runs of unmasked samples of the combined masks
+    this->groups = this->getCombinedMasks().getRuns(false, NbSamplesMin);
 }
 
 
@@ -0,0 +1,41 @@
+#include "ThreadPool.hpp"
+#include <algorithm>
+
+
+ThreadPool::ThreadPool(unsigned int nb_threads/*=0*/, size_t queue_capacity/*=0*/) : tasks(queue_capacity) {
+    // Constructor
+    if(nb_threads == 0) {
+        nb_threads = std::max((unsigned int)1, std::thread::hardware_concurrency());
+    }
+    for(unsigned int k = 0; k < nb_threads; k++) {
+        this->workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+
+ThreadPool::~ThreadPool() {
+    // Destructor: the remaining tasks are executed before stopping
+    this->tasks.close();
+    for(auto & worker : this->workers) {
+        worker.join();
+    }
+}
+
+
+unsigned int ThreadPool::getNumberOfThreads() const {
+    return (unsigned int)this->workers.size();
+}
+
+
+size_t ThreadPool::getQueueCapacity() const {
+    return this->tasks.getCapacity();
+}
+
+
+void ThreadPool::workerLoop() {
+    std::function<void()> task;
+    while(this->tasks.pop(task)) {
+        task();
+        task = nullptr;
+    }
+}
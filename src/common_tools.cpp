@@ -11,6 +11,8 @@
 #include <iostream>
 #include <cmath>
 #include <limits>
+#include <functional>
+#include <utility>
 
 
 bool exists(const std::string & name) {
@@ -47,14 +49,112 @@ std::vector<bool> mask_logical_or(const std::vector<bool> & maskA, const std::ve
     if(maskA.size() != maskB.size()) {
         throw std::runtime_error("Input mask sizes are not equal");
     }
-    std::vector<bool> OR_mask;
+    std::vector<bool> OR_mask(maskA.size(), false);
     for(size_t k = 0; k < maskA.size(); k++) {
-        OR_mask.push_back(maskA[k] || maskB[k]);
+        OR_mask[k] = maskA[k] || maskB[k];
     }
     return OR_mask;
 }
 
 
+// Median of a sliding window: the lower half of the samples in a max-heap, the upper half in a
+// min-heap (the median is the top of the lower half). Samples are identified by their index, the
+// ones leaving the window are only removed when they reach the top of a heap (lazy deletion).
+class SlidingMedian {
+public:
+    typedef std::pair<double, uint64_t> Sample;
+    SlidingMedian(uint64_t window_size) {
+        // Constructor
+        this->nb_low = 0;
+        this->nb_high = 0;
+        this->first = 0;
+        this->max_heaps_size = 2 * window_size + 16;
+        this->low.reserve(this->max_heaps_size + 1);
+        this->high.reserve(this->max_heaps_size + 1);
+    }
+    void add(double value, uint64_t index) {
+        Sample sample(value, index);
+        if((this->nb_low == 0) || (sample <= this->low.front())) {
+            this->low.push_back(sample);
+            std::push_heap(this->low.begin(), this->low.end(), std::less<Sample>());
+            this->nb_low++;
+        } else {
+            this->high.push_back(sample);
+            std::push_heap(this->high.begin(), this->high.end(), std::greater<Sample>());
+            this->nb_high++;
+        }
+        this->rebalance();
+    }
+    // Remove the oldest sample of the window (index: its index)
+    void removeOldest(double value, uint64_t index) {
+        this->first = index + 1;
+        if(Sample(value, index) <= this->low.front()) {
+            this->nb_low--;
+        } else {
+            this->nb_high--;
+        }
+        this->prune();
+        this->rebalance();
+        // Stale samples hidden under the tops: rebuild the heaps from time to time
+        if(this->low.size() + this->high.size() > this->max_heaps_size) {
+            this->compact(this->low, std::less<Sample>());
+            this->compact(this->high, std::greater<Sample>());
+        }
+    }
+    // Lower median of the samples of the window (at least one sample)
+    double get() const {
+        return this->low.front().first;
+    }
+private:
+    void prune() {
+        while(!this->low.empty() && (this->low.front().second < this->first)) {
+            std::pop_heap(this->low.begin(), this->low.end(), std::less<Sample>());
+            this->low.pop_back();
+        }
+        while(!this->high.empty() && (this->high.front().second < this->first)) {
+            std::pop_heap(this->high.begin(), this->high.end(), std::greater<Sample>());
+            this->high.pop_back();
+        }
+    }
+    void rebalance() {
+        // nb_low = nb_high or nb_high + 1
+        while(this->nb_low > this->nb_high + 1) {
+            std::pop_heap(this->low.begin(), this->low.end(), std::less<Sample>());
+            this->high.push_back(this->low.back());
+            this->low.pop_back();
+            std::push_heap(this->high.begin(), this->high.end(), std::greater<Sample>());
+            this->nb_low--;
+            this->nb_high++;
+            this->prune();
+        }
+        while(this->nb_low < this->nb_high) {
+            std::pop_heap(this->high.begin(), this->high.end(), std::greater<Sample>());
+            this->low.push_back(this->high.back());
+            this->high.pop_back();
+            std::push_heap(this->low.begin(), this->low.end(), std::less<Sample>());
+            this->nb_high--;
+            this->nb_low++;
+            this->prune();
+        }
+    }
+    template<typename Compare>
+    void compact(std::vector<Sample> & heap, Compare compare) {
+        uint64_t first = this->first;
+        heap.erase(std::remove_if(heap.begin(), heap.end(), [first](const Sample & sample) {return sample.second < first;}),
+                   heap.end());
+        std::make_heap(heap.begin(), heap.end(), compare);
+    }
+    std::vector<Sample> low;
+    std::vector<Sample> high;
+    // Number of samples of the window in each heap
+    uint64_t nb_low;
+    uint64_t nb_high;
+    // Index of the oldest sample of the window
+    uint64_t first;
+    size_t max_heaps_size;
+};
+
+
 std::vector<double> median_filter(const std::vector<double> & signal, uint64_t kernel_size) {
     double nan = std::numeric_limits<double>::quiet_NaN();
     // Size of the input signal
@@ -64,35 +164,44 @@ std::vector<double> median_filter(const std::vector<double> & signal, uint64_t k
         throw std::runtime_error("Kernel size of the median filer has to be an odd number");
     }
     // Minimum kernel size
-    if(kernel_size == 1) {
+    if((kernel_size == 1) || (N == 0)) {
         return signal;
     }
-    // Temporary vector to sort
-    std::vector<double> temp_array(kernel_size, 0);
-    // Indice of the median value of the temporary array
-    uint64_t kMiddle = (kernel_size - 1) / 2;
-    // Vector storing the result filtered signal
-    std::vector<double> signal_filtered;
-    for(uint64_t k = 0; k < signal.size(); k++) {
-        if(k < kMiddle) {
-            temp_array.assign(signal.begin(), signal.begin() + kernel_size);
-        } else if(k > N - kMiddle) {
-            temp_array.assign(signal.end() - kernel_size, signal.end());
+    // The window is centered on the sample, and stays inside the signal at its borders
+    uint64_t window_size = std::min(kernel_size, N);
+    // Indice of the median value of the window: NaN output if more than half of the window is NaN,
+    // median of the other samples otherwise
+    uint64_t kMiddle = (window_size - 1) / 2;
+    SlidingMedian median(window_size);
+    uint64_t nb_nan = 0;
+    for(uint64_t k = 0; k < window_size; k++) {
+        if(std::isnan(signal[k])) {
+            nb_nan++;
         } else {
-            temp_array.assign(signal.begin() + k - kMiddle, signal.begin() + k + kMiddle + 1);
+            median.add(signal[k], k);
         }
-        uint64_t nb_nan = count_nan(temp_array);
-        if(nb_nan > kMiddle) {
-            signal_filtered.push_back(nan);
-        } else if(nb_nan > 0) {
-            erase_nan(temp_array);
-            uint64_t kMiddleTemp = (temp_array.size()-1)/2;
-            std::sort(temp_array.begin(), temp_array.end());
-            signal_filtered.push_back(temp_array[kMiddleTemp]);
-        } else {
-            std::sort(temp_array.begin(), temp_array.end());
-            signal_filtered.push_back(temp_array[kMiddle]);
+    }
+    // Vector storing the result filtered signal
+    std::vector<double> signal_filtered(N);
+    uint64_t window_start = 0;
+    for(uint64_t k = 0; k < N; k++) {
+        uint64_t start = (k < kMiddle) ? 0 : std::min(k - kMiddle, N - window_size);
+        for(; window_start < start; window_start++) {
+            // Slide the window of one sample
+            double old_sample = signal[window_start];
+            double new_sample = signal[window_start + window_size];
+            if(std::isnan(old_sample)) {
+                nb_nan--;
+            } else {
+                median.removeOldest(old_sample, window_start);
+            }
+            if(std::isnan(new_sample)) {
+                nb_nan++;
+            } else {
+                median.add(new_sample, window_start + window_size);
+            }
         }
+        signal_filtered[k] = (nb_nan > kMiddle) ? nan : median.get();
     }
     return signal_filtered;
 }
@@ -118,7 +227,8 @@ double autocovariance(const std::vector<double> & data){
 
 // GAUSSIAN KDE
 /////////////////////////////////////////////////////////////////////
-GaussianKde::GaussianKde(const std::vector<double> & dataset, double bw_method) {
+GaussianKde::GaussianKde(const std::vector<double> & dataset, double bw_method, KdeMethod method/*=KdeMethod::EXACT*/) {
+    this->method = method;
     this->dataset = dataset;
     this->n = dataset.size();
     this->factor = bw_method;
@@ -126,7 +236,9 @@ GaussianKde::GaussianKde(const std::vector<double> & dataset, double bw_method)
 }
 
 
-GaussianKde::GaussianKde(const std::vector<double> & dataset, const std::string & bw_method/*="scott"*/) {
+GaussianKde::GaussianKde(const std::vector<double> & dataset, const std::string & bw_method/*="scott"*/,
+                         KdeMethod method/*=KdeMethod::EXACT*/) {
+    this->method = method;
     this->dataset = dataset;
     this->n = dataset.size();
     if(bw_method.compare("scott")) {
@@ -143,18 +255,51 @@ GaussianKde::GaussianKde(const std::vector<double> & dataset, const std::string
 void GaussianKde::computeCovariance() {
     this->_data_covariance = autocovariance(this->dataset);
     this->_data_inv_cov = 1.0/this->_data_covariance;
+    this->bins_extension = 0;
+    this->updateBandwidth();
+}
+
+
+void GaussianKde::updateBandwidth() {
     this->covariance = this->_data_covariance * pow(this->factor, 2);
     this->inv_cov = this->_data_inv_cov / pow(this->factor, 2);
     this->_norm_factor = sqrt(2 * M_PI * this->covariance) * this->n;
 }
 
 
+void GaussianKde::setBandwidth(double bw_method) {
+    this->factor = bw_method;
+    this->updateBandwidth();
+}
+
+
+double GaussianKde::getBandwidth() const {
+    return this->factor;
+}
+
+
 GaussianKde::~GaussianKde() {
     // Destructor
 }
 
 
+KdeMethod GaussianKde::getMethod() const {
+    return this->method;
+}
+
+
 std::vector<double> GaussianKde::evaluate(const std::vector<double> & points) {
+    if(this->method == KdeMethod::BINNED) {
+        std::vector<double> result = this->evaluateBinned(points);
+        if(!result.empty()) {
+            return result;
+        }
+    }
+    return this->evaluateExact(points);
+}
+
+
+std::vector<double> GaussianKde::evaluateExact(const std::vector<double> & points) const {
     uint64_t m = points.size();
     std::vector<double> result(m, 0);
     double diff;
@@ -173,6 +318,86 @@ std::vector<double> GaussianKde::evaluate(const std::vector<double> & points) {
     }
     return result;
 }
+
+
+void GaussianKde::binSamples(const std::vector<double> & points, double step, uint64_t extension) {
+    uint64_t m = points.size();
+    uint64_t nb_bins = m + 2 * extension;
+    // Large enough for the convolution with any kernel of half size <= extension (no aliasing)
+    uint64_t fft_size = next_power_of_two(std::max(nb_bins + extension + 1, (uint64_t)2));
+    // Linear binning: each sample is shared between its two neighbour bins
+    std::vector<double> bins(fft_size, 0.0);
+    double origin = points[0] - (double)extension * step;
+    for(const auto & sample : this->dataset) {
+        double position = (sample - origin) / step;
+        if(!(position >= 0) || !(position < (double)(nb_bins - 1))) {
+            continue;
+        }
+        uint64_t ind = (uint64_t)position;
+        double weight = position - (double)ind;
+        bins[ind] += 1.0 - weight;
+        bins[ind + 1] += weight;
+    }
+    this->binned_points = points;
+    this->bins_extension = extension;
+    this->bins_fft = std::make_shared<const RealFFT>(fft_size);
+    this->bins_fft->forward(bins, this->bins_spectrum);
+}
+
+
+std::vector<double> GaussianKde::evaluateBinned(const std::vector<double> & points) {
+    uint64_t m = points.size();
+    if(m < 2) {
+        return std::vector<double>();
+    }
+    // Step of the grid of points
+    double step = (points[m - 1] - points[0]) / (double)(m - 1);
+    if(!(step > 0)) {
+        return std::vector<double>();
+    }
+    for(uint64_t p = 1; p < m; p++) {
+        if(std::abs(points[p] - points[0] - step * (double)p) > 1e-6 * step) {
+            return std::vector<double>();
+        }
+    }
+    // Half size of the truncated kernel
+    double kernel_size = ceil(KDE_BINNED_TRUNCATION * sqrt(this->covariance) / step);
+    if(!(kernel_size <= KDE_BINNED_MAX_KERNEL_RATIO * (double)m)) {
+        // Kernel much wider than the grid (or undefined covariance)
+        return std::vector<double>();
+    }
+    uint64_t L = (uint64_t)kernel_size;
+    // The grid is extended on both sides for the samples outside of the points: the bins are
+    // kept for the next evaluations on the same points with a kernel which is not wider
+    if((this->bins_extension == 0) || (L > this->bins_extension) || (points != this->binned_points)) {
+        this->binSamples(points, step, std::max(L, (uint64_t)1));
+    }
+    uint64_t fft_size = this->bins_fft->getSize();
+    // Kernel centered on the first sample (negative lags at the end)
+    std::vector<double> kernel(fft_size, 0.0);
+    for(uint64_t j = 0; j <= L; j++) {
+        double diff = (double)j * step;
+        double value = exp(-diff * this->inv_cov * diff / 2.0);
+        kernel[j] = value;
+        if(j > 0) {
+            kernel[fft_size - j] = value;
+        }
+    }
+    // Circular convolution of the bins with the kernel
+    std::vector<std::complex<double>> spectrum;
+    this->bins_fft->forward(kernel, spectrum);
+    for(size_t k = 0; k < spectrum.size(); k++) {
+        spectrum[k] *= this->bins_spectrum[k];
+    }
+    std::vector<double> density;
+    this->bins_fft->inverse(spectrum, density);
+    std::vector<double> result(m);
+    for(uint64_t p = 0; p < m; p++) {
+        // Rounding errors of the FFT can give tiny negative values
+        result[p] = std::max(density[p + this->bins_extension], 0.0) / this->_norm_factor;
+    }
+    return result;
+}
 /////////////////////////////////////////////////////////////////////
 
 std::vector<double> get_histogram_points(const std::vector<double> & signal, uint64_t bins) {
@@ -200,31 +425,50 @@ std::vector<double> get_histogram_points(const std::vector<double> & signal, uin
 
 // classic Histogram
 Histogram histogram(const std::vector<double> & data, uint64_t bins, double range_min, double range_max) {
+    Histogram result;
+    histogram(data, bins, range_min, range_max, result);
+    return result;
+}
+
+
+void histogram(const std::vector<double> & data, uint64_t bins, double range_min, double range_max,
+               Histogram & result, bool accumulate/*=false*/) {
     if(data.size() <= 1) {
         throw std::runtime_error("input data should have multiple elements");
     }
+    if(accumulate && (result.data.size() != bins)) {
+        throw std::runtime_error("Histogram to accumulate does not have the same number of bins");
+    }
     double stepbins = (range_max - range_min) / (double)bins;
-    std::vector<double> data_sorted = data;
-    std::sort(data_sorted.begin(), data_sorted.end());
-    // Initialization
-    size_t pmin = 0;
-    Histogram result;
-    result.x.push_back(range_min);
-    result.data = std::vector<double>(bins, 0);
+    // Edges of the bins
+    result.x.resize(bins + 1);
+    result.x[0] = range_min;
     for (size_t k = 0; k < bins; k++) {
-        result.x.push_back(range_min + stepbins*(k + 1));
-        for(size_t p = pmin; p < data_sorted.size(); p++) {
-            if((k == bins - 1) && (data_sorted[p] == result.x[k + 1])) {
-                result.data[k] = result.data[k] + 1.0;
-            } else if(data_sorted[p] >= result.x[k + 1]) {
-                pmin = p;
-                break;
-            } else if((data_sorted[p] >= result.x[k]) && (data_sorted[p] < result.x[k + 1])) {
-                result.data[k] = result.data[k] + 1.0;
-            }
+        result.x[k + 1] = range_min + stepbins*(k + 1);
+    }
+    if(!accumulate) {
+        result.data.assign(bins, 0);
+    }
+    if(bins == 0) {
+        return;
+    }
+    for(const auto & sample : data) {
+        // Samples outside of the range (and NaN) are not counted
+        if(!(sample >= result.x[0]) || !(sample <= result.x[bins])) {
+            continue;
+        }
+        // Bin computed from its width then checked against its edges (rounding errors): the samples
+        // of a bin are in [x[k], x[k+1]), the last bin also counts the samples equal to range_max
+        double position = (sample - range_min) / stepbins;
+        size_t ind = (position < (double)bins) ? (size_t)position : (size_t)(bins - 1);
+        while((ind > 0) && (sample < result.x[ind])) {
+            ind--;
+        }
+        while((ind < bins - 1) && (sample >= result.x[ind + 1])) {
+            ind++;
         }
+        result.data[ind] = result.data[ind] + 1.0;
     }
-    return result;
 }
 
 
@@ -260,3 +504,138 @@ std::vector<double> gaussian(uint64_t nb_samples, double standard_deviation, boo
     }
     return result;
 }
+
+
+uint64_t next_power_of_two(uint64_t value) {
+    uint64_t result = 1;
+    while(result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+
+int64_t get_window_start(double hop_size, uint64_t index) {
+    return (int64_t)round(hop_size * (double)index);
+}
+
+
+// REAL FFT
+/////////////////////////////////////////////////////////////////////
+RealFFT::RealFFT(uint64_t size) {
+    if((size < 2) || (size & (size - 1))) {
+        throw std::runtime_error("FFT size must be a power of two superior or equal to 2");
+    }
+    this->size = size;
+    // The real signal is processed as a complex signal of half size
+    uint64_t half = size / 2;
+    uint64_t nb_bits = 0;
+    while(((uint64_t)1 << nb_bits) < half) {
+        nb_bits++;
+    }
+    this->bit_reversed.assign(half, 0);
+    for(uint64_t k = 0; k < half; k++) {
+        uint64_t reversed = 0;
+        for(uint64_t bit = 0; bit < nb_bits; bit++) {
+            reversed |= ((k >> bit) & 1) << (nb_bits - 1 - bit);
+        }
+        this->bit_reversed[k] = reversed;
+    }
+    for(uint64_t k = 0; k < half / 2; k++) {
+        this->twiddles.push_back(std::polar(1.0, -2.0 * M_PI * (double)k / (double)half));
+    }
+    for(uint64_t k = 0; k <= half; k++) {
+        this->real_twiddles.push_back(std::polar(1.0, -2.0 * M_PI * (double)k / (double)size));
+    }
+}
+
+
+RealFFT::~RealFFT() {
+    // Destructor
+}
+
+
+uint64_t RealFFT::getSize() const {
+    return this->size;
+}
+
+
+void RealFFT::transform(std::complex<double> * data, bool inverse) const {
+    uint64_t n = this->size / 2;
+    for(uint64_t k = 0; k < n; k++) {
+        if(k < this->bit_reversed[k]) {
+            std::swap(data[k], data[this->bit_reversed[k]]);
+        }
+    }
+    double sign = inverse ? -1.0 : 1.0;
+    for(uint64_t length = 2; length <= n; length <<= 1) {
+        uint64_t half = length / 2;
+        uint64_t step = n / length;
+        for(uint64_t start = 0; start < n; start += length) {
+            for(uint64_t k = 0; k < half; k++) {
+                const std::complex<double> & w = this->twiddles[k * step];
+                double w_re = w.real();
+                double w_im = sign * w.imag();
+                std::complex<double> & a = data[start + k];
+                std::complex<double> & b = data[start + k + half];
+                double v_re = b.real() * w_re - b.imag() * w_im;
+                double v_im = b.real() * w_im + b.imag() * w_re;
+                b = std::complex<double>(a.real() - v_re, a.imag() - v_im);
+                a = std::complex<double>(a.real() + v_re, a.imag() + v_im);
+            }
+        }
+    }
+}
+
+
+void RealFFT::forward(const std::vector<double> & signal, std::vector<std::complex<double>> & spectrum) const {
+    if(signal.size() > this->size) {
+        throw std::runtime_error("Input signal is longer than the FFT size");
+    }
+    uint64_t half = this->size / 2;
+    spectrum.resize(half + 1);
+    // Pack the even samples as real part and the odd samples as imaginary part
+    for(uint64_t k = 0; k < half; k++) {
+        double even = (2 * k < signal.size()) ? signal[2 * k] : 0.0;
+        double odd = (2 * k + 1 < signal.size()) ? signal[2 * k + 1] : 0.0;
+        spectrum[k] = std::complex<double>(even, odd);
+    }
+    this->transform(spectrum.data(), false);
+    // Split the spectrum of the packed signal into the spectrum of the real signal
+    std::complex<double> first = spectrum[0];
+    spectrum[0] = std::complex<double>(first.real() + first.imag(), 0.0);
+    spectrum[half] = std::complex<double>(first.real() - first.imag(), 0.0);
+    for(uint64_t k = 1; k <= half / 2; k++) {
+        uint64_t j = half - k;
+        std::complex<double> zk = spectrum[k];
+        std::complex<double> zj = spectrum[j];
+        std::complex<double> even = 0.5 * (zk + std::conj(zj));
+        std::complex<double> odd = std::complex<double>(0.0, -0.5) * (zk - std::conj(zj));
+        spectrum[k] = even + this->real_twiddles[k] * odd;
+        spectrum[j] = std::conj(even) + this->real_twiddles[j] * std::conj(odd);
+    }
+}
+
+
+void RealFFT::inverse(const std::vector<std::complex<double>> & spectrum, std::vector<double> & signal) const {
+    uint64_t half = this->size / 2;
+    if(spectrum.size() != half + 1) {
+        throw std::runtime_error("Input spectrum size does not match the FFT size");
+    }
+    signal.resize(this->size);
+    // The output samples are used as storage for the packed complex signal
+    std::complex<double> * packed = reinterpret_cast<std::complex<double>*>(signal.data());
+    for(uint64_t k = 0; k < half; k++) {
+        std::complex<double> xk = spectrum[k];
+        std::complex<double> xj = std::conj(spectrum[half - k]);
+        std::complex<double> even = 0.5 * (xk + xj);
+        std::complex<double> odd = 0.5 * (xk - xj) * std::conj(this->real_twiddles[k]);
+        packed[k] = even + std::complex<double>(0.0, 1.0) * odd;
+    }
+    this->transform(packed, true);
+    double scale = 1.0 / (double)half;
+    for(auto & sample : signal) {
+        sample *= scale;
+    }
+}
+/////////////////////////////////////////////////////////////////////
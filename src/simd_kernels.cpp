@@ -0,0 +1,606 @@
+#include "simd_kernels.hpp"
+#include <atomic>
+#include <stdexcept>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    #define SIMD_KERNELS_X86
+    #include <immintrin.h>
+#endif
+
+
+// SCALAR
+/////////////////////////////////////////////////////////////////////
+static double scalar_sum(const double * x, size_t n) {
+    double result = 0.0;
+    for(size_t i = 0; i < n; i++) {
+        result += x[i];
+    }
+    return result;
+}
+
+
+static double scalar_dot(const double * x, const double * y, size_t n) {
+    double result = 0.0;
+    for(size_t i = 0; i < n; i++) {
+        result += x[i] * y[i];
+    }
+    return result;
+}
+
+
+static double scalar_sum_squares(const double * x, size_t n) {
+    return scalar_dot(x, x, n);
+}
+
+
+static void scalar_subtract(const double * x, double value, double * y, size_t n) {
+    for(size_t i = 0; i < n; i++) {
+        y[i] = x[i] - value;
+    }
+}
+
+
+static double scalar_sum_f(const float * x, size_t n) {
+    double result = 0.0;
+    for(size_t i = 0; i < n; i++) {
+        result += x[i];
+    }
+    return result;
+}
+
+
+static double scalar_dot_f(const float * x, const float * y, size_t n) {
+    double result = 0.0;
+    for(size_t i = 0; i < n; i++) {
+        result += (double)x[i] * (double)y[i];
+    }
+    return result;
+}
+
+
+static double scalar_sum_squares_f(const float * x, size_t n) {
+    return scalar_dot_f(x, x, n);
+}
+
+
+static void scalar_subtract_f(const float * x, float value, float * y, size_t n) {
+    for(size_t i = 0; i < n; i++) {
+        y[i] = x[i] - value;
+    }
+}
+/////////////////////////////////////////////////////////////////////
+
+
+#ifdef SIMD_KERNELS_X86
+// SSE2
+/////////////////////////////////////////////////////////////////////
+__attribute__((target("sse2")))
+static double sse2_hsum(__m128d v) {
+    return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+}
+
+
+__attribute__((target("sse2")))
+static double sse2_sum(const double * x, size_t n) {
+    __m128d acc0 = _mm_setzero_pd();
+    __m128d acc1 = _mm_setzero_pd();
+    size_t i = 0;
+    for(; i + 4 <= n; i += 4) {
+        acc0 = _mm_add_pd(acc0, _mm_loadu_pd(x + i));
+        acc1 = _mm_add_pd(acc1, _mm_loadu_pd(x + i + 2));
+    }
+    double result = sse2_hsum(_mm_add_pd(acc0, acc1));
+    for(; i < n; i++) {
+        result += x[i];
+    }
+    return result;
+}
+
+
+__attribute__((target("sse2")))
+static double sse2_dot(const double * x, const double * y, size_t n) {
+    __m128d acc0 = _mm_setzero_pd();
+    __m128d acc1 = _mm_setzero_pd();
+    size_t i = 0;
+    for(; i + 4 <= n; i += 4) {
+        acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i)));
+        acc1 = _mm_add_pd(acc1, _mm_mul_pd(_mm_loadu_pd(x + i + 2), _mm_loadu_pd(y + i + 2)));
+    }
+    double result = sse2_hsum(_mm_add_pd(acc0, acc1));
+    for(; i < n; i++) {
+        result += x[i] * y[i];
+    }
+    return result;
+}
+
+
+__attribute__((target("sse2")))
+static double sse2_sum_squares(const double * x, size_t n) {
+    return sse2_dot(x, x, n);
+}
+
+
+__attribute__((target("sse2")))
+static void sse2_subtract(const double * x, double value, double * y, size_t n) {
+    __m128d v = _mm_set1_pd(value);
+    size_t i = 0;
+    for(; i + 2 <= n; i += 2) {
+        _mm_storeu_pd(y + i, _mm_sub_pd(_mm_loadu_pd(x + i), v));
+    }
+    for(; i < n; i++) {
+        y[i] = x[i] - value;
+    }
+}
+
+
+// The float lanes are widened to double before the horizontal sum
+__attribute__((target("sse2")))
+static double sse2_hsum_f(__m128 v) {
+    return sse2_hsum(_mm_add_pd(_mm_cvtps_pd(v), _mm_cvtps_pd(_mm_movehl_ps(v, v))));
+}
+
+
+__attribute__((target("sse2")))
+static double sse2_sum_f(const float * x, size_t n) {
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_loadu_ps(x + i));
+        acc1 = _mm_add_ps(acc1, _mm_loadu_ps(x + i + 4));
+    }
+    double result = sse2_hsum_f(_mm_add_ps(acc0, acc1));
+    for(; i < n; i++) {
+        result += x[i];
+    }
+    return result;
+}
+
+
+__attribute__((target("sse2")))
+static double sse2_dot_f(const float * x, const float * y, size_t n) {
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(x + i), _mm_loadu_ps(y + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(x + i + 4), _mm_loadu_ps(y + i + 4)));
+    }
+    double result = sse2_hsum_f(_mm_add_ps(acc0, acc1));
+    for(; i < n; i++) {
+        result += (double)x[i] * (double)y[i];
+    }
+    return result;
+}
+
+
+__attribute__((target("sse2")))
+static double sse2_sum_squares_f(const float * x, size_t n) {
+    return sse2_dot_f(x, x, n);
+}
+
+
+__attribute__((target("sse2")))
+static void sse2_subtract_f(const float * x, float value, float * y, size_t n) {
+    __m128 v = _mm_set1_ps(value);
+    size_t i = 0;
+    for(; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(y + i, _mm_sub_ps(_mm_loadu_ps(x + i), v));
+    }
+    for(; i < n; i++) {
+        y[i] = x[i] - value;
+    }
+}
+/////////////////////////////////////////////////////////////////////
+
+
+// AVX2 (+FMA)
+/////////////////////////////////////////////////////////////////////
+__attribute__((target("avx2,fma")))
+static double avx2_hsum(__m256d v) {
+    __m128d sum = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(sum, _mm_unpackhi_pd(sum, sum)));
+}
+
+
+__attribute__((target("avx2,fma")))
+static double avx2_sum(const double * x, size_t n) {
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8) {
+        acc0 = _mm256_add_pd(acc0, _mm256_loadu_pd(x + i));
+        acc1 = _mm256_add_pd(acc1, _mm256_loadu_pd(x + i + 4));
+    }
+    double result = avx2_hsum(_mm256_add_pd(acc0, acc1));
+    for(; i < n; i++) {
+        result += x[i];
+    }
+    return result;
+}
+
+
+__attribute__((target("avx2,fma")))
+static double avx2_dot(const double * x, const double * y, size_t n) {
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8) {
+        acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i), acc0);
+        acc1 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4), acc1);
+    }
+    double result = avx2_hsum(_mm256_add_pd(acc0, acc1));
+    for(; i < n; i++) {
+        result += x[i] * y[i];
+    }
+    return result;
+}
+
+
+__attribute__((target("avx2,fma")))
+static double avx2_sum_squares(const double * x, size_t n) {
+    return avx2_dot(x, x, n);
+}
+
+
+__attribute__((target("avx2,fma")))
+static void avx2_subtract(const double * x, double value, double * y, size_t n) {
+    __m256d v = _mm256_set1_pd(value);
+    size_t i = 0;
+    for(; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(y + i, _mm256_sub_pd(_mm256_loadu_pd(x + i), v));
+    }
+    for(; i < n; i++) {
+        y[i] = x[i] - value;
+    }
+}
+
+
+__attribute__((target("avx2,fma")))
+static double avx2_hsum_f(__m256 v) {
+    __m256d low = _mm256_cvtps_pd(_mm256_castps256_ps128(v));
+    __m256d high = _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1));
+    return avx2_hsum(_mm256_add_pd(low, high));
+}
+
+
+__attribute__((target("avx2,fma")))
+static double avx2_sum_f(const float * x, size_t n) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    size_t i = 0;
+    for(; i + 16 <= n; i += 16) {
+        acc0 = _mm256_add_ps(acc0, _mm256_loadu_ps(x + i));
+        acc1 = _mm256_add_ps(acc1, _mm256_loadu_ps(x + i + 8));
+    }
+    double result = avx2_hsum_f(_mm256_add_ps(acc0, acc1));
+    for(; i < n; i++) {
+        result += x[i];
+    }
+    return result;
+}
+
+
+__attribute__((target("avx2,fma")))
+static double avx2_dot_f(const float * x, const float * y, size_t n) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    size_t i = 0;
+    for(; i + 16 <= n; i += 16) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i + 8), _mm256_loadu_ps(y + i + 8), acc1);
+    }
+    double result = avx2_hsum_f(_mm256_add_ps(acc0, acc1));
+    for(; i < n; i++) {
+        result += (double)x[i] * (double)y[i];
+    }
+    return result;
+}
+
+
+__attribute__((target("avx2,fma")))
+static double avx2_sum_squares_f(const float * x, size_t n) {
+    return avx2_dot_f(x, x, n);
+}
+
+
+__attribute__((target("avx2,fma")))
+static void avx2_subtract_f(const float * x, float value, float * y, size_t n) {
+    __m256 v = _mm256_set1_ps(value);
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(y + i, _mm256_sub_ps(_mm256_loadu_ps(x + i), v));
+    }
+    for(; i < n; i++) {
+        y[i] = x[i] - value;
+    }
+}
+/////////////////////////////////////////////////////////////////////
+
+
+// AVX-512
+/////////////////////////////////////////////////////////////////////
+// The halves are extracted with zero-masking: the unmasked extractions and conversions of the
+// compiler headers start from an undefined vector (uninitialized warnings of GCC)
+__attribute__((target("avx512f")))
+static __m256d avx512_half(__m512d v, bool high) {
+    return high ? _mm512_maskz_extractf64x4_pd(0xF, v, 1) : _mm512_maskz_extractf64x4_pd(0xF, v, 0);
+}
+
+
+// Same order of the additions as _mm512_reduce_add_pd
+__attribute__((target("avx512f")))
+static double avx512_hsum(__m512d v) {
+    __m256d sum4 = _mm256_add_pd(avx512_half(v, false), avx512_half(v, true));
+    __m128d sum2 = _mm_add_pd(_mm256_castpd256_pd128(sum4), _mm256_extractf128_pd(sum4, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(sum2, _mm_unpackhi_pd(sum2, sum2)));
+}
+
+
+__attribute__((target("avx512f")))
+static double avx512_sum(const double * x, size_t n) {
+    __m512d acc0 = _mm512_setzero_pd();
+    __m512d acc1 = _mm512_setzero_pd();
+    size_t i = 0;
+    for(; i + 16 <= n; i += 16) {
+        acc0 = _mm512_add_pd(acc0, _mm512_loadu_pd(x + i));
+        acc1 = _mm512_add_pd(acc1, _mm512_loadu_pd(x + i + 8));
+    }
+    double result = avx512_hsum(_mm512_add_pd(acc0, acc1));
+    for(; i < n; i++) {
+        result += x[i];
+    }
+    return result;
+}
+
+
+__attribute__((target("avx512f")))
+static double avx512_dot(const double * x, const double * y, size_t n) {
+    __m512d acc0 = _mm512_setzero_pd();
+    __m512d acc1 = _mm512_setzero_pd();
+    size_t i = 0;
+    for(; i + 16 <= n; i += 16) {
+        acc0 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i), acc0);
+        acc1 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i + 8), _mm512_loadu_pd(y + i + 8), acc1);
+    }
+    double result = avx512_hsum(_mm512_add_pd(acc0, acc1));
+    for(; i < n; i++) {
+        result += x[i] * y[i];
+    }
+    return result;
+}
+
+
+__attribute__((target("avx512f")))
+static double avx512_sum_squares(const double * x, size_t n) {
+    return avx512_dot(x, x, n);
+}
+
+
+__attribute__((target("avx512f")))
+static void avx512_subtract(const double * x, double value, double * y, size_t n) {
+    __m512d v = _mm512_set1_pd(value);
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8) {
+        _mm512_storeu_pd(y + i, _mm512_sub_pd(_mm512_loadu_pd(x + i), v));
+    }
+    for(; i < n; i++) {
+        y[i] = x[i] - value;
+    }
+}
+
+
+__attribute__((target("avx512f")))
+static double avx512_hsum_f(__m512 v) {
+    __m512d low = _mm512_maskz_cvtps_pd(0xFF, _mm256_castpd_ps(avx512_half(_mm512_castps_pd(v), false)));
+    __m512d high = _mm512_maskz_cvtps_pd(0xFF, _mm256_castpd_ps(avx512_half(_mm512_castps_pd(v), true)));
+    return avx512_hsum(_mm512_add_pd(low, high));
+}
+
+
+__attribute__((target("avx512f")))
+static double avx512_sum_f(const float * x, size_t n) {
+    __m512 acc0 = _mm512_setzero_ps();
+    __m512 acc1 = _mm512_setzero_ps();
+    size_t i = 0;
+    for(; i + 32 <= n; i += 32) {
+        acc0 = _mm512_add_ps(acc0, _mm512_loadu_ps(x + i));
+        acc1 = _mm512_add_ps(acc1, _mm512_loadu_ps(x + i + 16));
+    }
+    double result = avx512_hsum_f(_mm512_add_ps(acc0, acc1));
+    for(; i < n; i++) {
+        result += x[i];
+    }
+    return result;
+}
+
+
+__attribute__((target("avx512f")))
+static double avx512_dot_f(const float * x, const float * y, size_t n) {
+    __m512 acc0 = _mm512_setzero_ps();
+    __m512 acc1 = _mm512_setzero_ps();
+    size_t i = 0;
+    for(; i + 32 <= n; i += 32) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i), acc0);
+        acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(x + i + 16), _mm512_loadu_ps(y + i + 16), acc1);
+    }
+    double result = avx512_hsum_f(_mm512_add_ps(acc0, acc1));
+    for(; i < n; i++) {
+        result += (double)x[i] * (double)y[i];
+    }
+    return result;
+}
+
+
+__attribute__((target("avx512f")))
+static double avx512_sum_squares_f(const float * x, size_t n) {
+    return avx512_dot_f(x, x, n);
+}
+
+
+__attribute__((target("avx512f")))
+static void avx512_subtract_f(const float * x, float value, float * y, size_t n) {
+    __m512 v = _mm512_set1_ps(value);
+    size_t i = 0;
+    for(; i + 16 <= n; i += 16) {
+        _mm512_storeu_ps(y + i, _mm512_sub_ps(_mm512_loadu_ps(x + i), v));
+    }
+    for(; i < n; i++) {
+        y[i] = x[i] - value;
+    }
+}
+/////////////////////////////////////////////////////////////////////
+#endif /* SIMD_KERNELS_X86 */
+
+
+// DISPATCH
+/////////////////////////////////////////////////////////////////////
+struct KernelTable {
+    InstructionSet instruction_set;
+    double (*sum)(const double *, size_t);
+    double (*dot)(const double *, const double *, size_t);
+    double (*sum_squares)(const double *, size_t);
+    void (*subtract)(const double *, double, double *, size_t);
+    double (*sum_f)(const float *, size_t);
+    double (*dot_f)(const float *, const float *, size_t);
+    double (*sum_squares_f)(const float *, size_t);
+    void (*subtract_f)(const float *, float, float *, size_t);
+};
+
+
+static const KernelTable SCALAR_KERNELS = {InstructionSet::SCALAR, scalar_sum, scalar_dot, scalar_sum_squares, scalar_subtract,
+    scalar_sum_f, scalar_dot_f, scalar_sum_squares_f, scalar_subtract_f};
+#ifdef SIMD_KERNELS_X86
+static const KernelTable SSE2_KERNELS = {InstructionSet::SSE2, sse2_sum, sse2_dot, sse2_sum_squares, sse2_subtract,
+    sse2_sum_f, sse2_dot_f, sse2_sum_squares_f, sse2_subtract_f};
+static const KernelTable AVX2_KERNELS = {InstructionSet::AVX2, avx2_sum, avx2_dot, avx2_sum_squares, avx2_subtract,
+    avx2_sum_f, avx2_dot_f, avx2_sum_squares_f, avx2_subtract_f};
+static const KernelTable AVX512_KERNELS = {InstructionSet::AVX512, avx512_sum, avx512_dot, avx512_sum_squares, avx512_subtract,
+    avx512_sum_f, avx512_dot_f, avx512_sum_squares_f, avx512_subtract_f};
+#endif
+
+
+static const KernelTable * get_kernel_table(InstructionSet instruction_set) {
+    switch(instruction_set) {
+#ifdef SIMD_KERNELS_X86
+        case InstructionSet::SSE2:
+            return &SSE2_KERNELS;
+        case InstructionSet::AVX2:
+            return &AVX2_KERNELS;
+        case InstructionSet::AVX512:
+            return &AVX512_KERNELS;
+#endif
+        default:
+            return &SCALAR_KERNELS;
+    }
+}
+
+
+static const KernelTable * select_best_kernels() {
+    for(auto instruction_set : {InstructionSet::AVX512, InstructionSet::AVX2, InstructionSet::SSE2}) {
+        if(instruction_set_supported(instruction_set)) {
+            return get_kernel_table(instruction_set);
+        }
+    }
+    return &SCALAR_KERNELS;
+}
+
+
+static std::atomic<const KernelTable *> current_kernels(nullptr);
+
+
+static const KernelTable * kernels() {
+    const KernelTable * table = current_kernels.load(std::memory_order_acquire);
+    if(table == nullptr) {
+        // Concurrent first calls select the same table
+        table = select_best_kernels();
+        current_kernels.store(table, std::memory_order_release);
+    }
+    return table;
+}
+
+
+bool instruction_set_supported(InstructionSet instruction_set) {
+    switch(instruction_set) {
+        case InstructionSet::SCALAR:
+            return true;
+#ifdef SIMD_KERNELS_X86
+        case InstructionSet::SSE2:
+            return __builtin_cpu_supports("sse2");
+        case InstructionSet::AVX2:
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        case InstructionSet::AVX512:
+            return __builtin_cpu_supports("avx512f");
+#endif
+        default:
+            return false;
+    }
+}
+
+
+InstructionSet get_instruction_set() {
+    return kernels()->instruction_set;
+}
+
+
+void set_instruction_set(InstructionSet instruction_set) {
+    if(!instruction_set_supported(instruction_set)) {
+        throw std::runtime_error("Instruction set not supported: " + enum_to_string(instruction_set));
+    }
+    current_kernels.store(get_kernel_table(instruction_set), std::memory_order_release);
+}
+
+
+std::string enum_to_string(InstructionSet instruction_set) {
+    switch(instruction_set) {
+        case InstructionSet::SSE2:
+            return "SSE2";
+        case InstructionSet::AVX2:
+            return "AVX2";
+        case InstructionSet::AVX512:
+            return "AVX512";
+        default:
+            return "SCALAR";
+    }
+}
+/////////////////////////////////////////////////////////////////////
+
+
+double kernel_sum(const double * x, size_t n) {
+    return kernels()->sum(x, n);
+}
+
+
+double kernel_dot(const double * x, const double * y, size_t n) {
+    return kernels()->dot(x, y, n);
+}
+
+
+double kernel_sum_squares(const double * x, size_t n) {
+    return kernels()->sum_squares(x, n);
+}
+
+
+void kernel_subtract(const double * x, double value, double * y, size_t n) {
+    kernels()->subtract(x, value, y, n);
+}
+
+
+double kernel_sum(const float * x, size_t n) {
+    return kernels()->sum_f(x, n);
+}
+
+
+double kernel_dot(const float * x, const float * y, size_t n) {
+    return kernels()->dot_f(x, y, n);
+}
+
+
+double kernel_sum_squares(const float * x, size_t n) {
+    return kernels()->sum_squares_f(x, n);
+}
+
+
+void kernel_subtract(const float * x, float value, float * y, size_t n) {
+    kernels()->subtract_f(x, value, y, n);
+}
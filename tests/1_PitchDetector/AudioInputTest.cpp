@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "AudioInput.hpp"
+
+
+static std::vector<uint8_t> getBytes(size_t size) {
+    std::vector<uint8_t> bytes(size);
+    for(size_t k = 0; k < size; k++) {
+        bytes[k] = (uint8_t)((k * 7 + k / 251) & 0xFF);
+    }
+    return bytes;
+}
+
+
+TEST(AudioInputTest, Buffer) {
+    std::vector<uint8_t> bytes = getBytes(1000);
+    AudioInput input(bytes.data(), bytes.size());
+    EXPECT_EQ(input.getName(), "memory");
+    EXPECT_FALSE(input.isStream());
+    EXPECT_EQ(input.getSize(), 1000);
+    std::vector<uint8_t> buffer(300);
+    EXPECT_EQ(input.read(100, buffer.data(), buffer.size()), 300);
+    EXPECT_TRUE(std::equal(buffer.begin(), buffer.end(), bytes.begin() + 100));
+    // End of the input
+    EXPECT_EQ(input.read(900, buffer.data(), buffer.size()), 100);
+    EXPECT_TRUE(std::equal(buffer.begin(), buffer.begin() + 100, bytes.begin() + 900));
+    EXPECT_EQ(input.read(1000, buffer.data(), buffer.size()), 0);
+}
+
+
+TEST(AudioInputTest, Stream) {
+    std::vector<uint8_t> bytes = getBytes(3 * AUDIO_INPUT_CHUNK_SIZE + 123);
+    std::istringstream stream(std::string(bytes.begin(), bytes.end()));
+    AudioInput input(stream, "stdin");
+    EXPECT_EQ(input.getName(), "stdin");
+    EXPECT_TRUE(input.isStream());
+    // The stream is read when needed, its size is known at its end
+    std::vector<uint8_t> buffer(1000);
+    EXPECT_EQ(input.read(0, buffer.data(), buffer.size()), 1000);
+    EXPECT_TRUE(std::equal(buffer.begin(), buffer.end(), bytes.begin()));
+    EXPECT_EQ(input.getSize(), -1);
+    // Going back in the stream
+    EXPECT_EQ(input.read(2 * AUDIO_INPUT_CHUNK_SIZE, buffer.data(), buffer.size()), 1000);
+    EXPECT_TRUE(std::equal(buffer.begin(), buffer.end(), bytes.begin() + 2 * AUDIO_INPUT_CHUNK_SIZE));
+    EXPECT_EQ(input.read(10, buffer.data(), buffer.size()), 1000);
+    EXPECT_TRUE(std::equal(buffer.begin(), buffer.end(), bytes.begin() + 10));
+    EXPECT_EQ(input.readAll(), (int64_t)bytes.size());
+    EXPECT_EQ(input.getSize(), (int64_t)bytes.size());
+    EXPECT_EQ(input.read(bytes.size() - 23, buffer.data(), buffer.size()), 23);
+}
+
+
+TEST(AudioInputTest, ConcurrentReads) {
+    std::vector<uint8_t> bytes = getBytes(20 * AUDIO_INPUT_CHUNK_SIZE);
+    std::istringstream stream(std::string(bytes.begin(), bytes.end()));
+    AudioInput input(stream);
+    // Readers of several parts of the stream at the same time
+    std::vector<std::thread> threads;
+    std::vector<int> valid(4, 0);
+    for(size_t t = 0; t < valid.size(); t++) {
+        threads.push_back(std::thread([&, t]() {
+            std::vector<uint8_t> buffer(4096);
+            bool same = true;
+            for(uint64_t position = t * 1000; position < bytes.size(); position += buffer.size()) {
+                size_t nb_bytes = input.read(position, buffer.data(), buffer.size());
+                same = same && (nb_bytes == std::min(buffer.size(), (size_t)(bytes.size() - position)));
+                same = same && std::equal(buffer.begin(), buffer.begin() + nb_bytes, bytes.begin() + position);
+            }
+            valid[t] = same ? 1 : 0;
+        }));
+    }
+    for(auto & thread : threads) {
+        thread.join();
+    }
+    for(size_t t = 0; t < valid.size(); t++) {
+        EXPECT_EQ(valid[t], 1);
+    }
+}
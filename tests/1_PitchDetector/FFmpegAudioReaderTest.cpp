@@ -1,7 +1,11 @@
 #include <gtest/gtest.h>
 #include <iostream>
+#include <fstream>
+#include <iterator>
+#include <memory>
 #include <string>
 #include <vector>
+#include <algorithm>
 #include "FFmpegAudioReader.hpp"
 #include "McLeodPitchExtractorMethod.hpp"
 
@@ -33,6 +37,7 @@ TEST(AudioReaderTest, WavAudioFile) {
     parameters.windowstimesize_s = 20e-3;
     parameters.period_s = 1e-3;
     parameters.resample_rate_hz = 44100;
+    parameters.sample_format = SampleFormat::DOUBLE;
     audio_reader.initExtraction(parameters);
     ExtractBuffers(audio_reader);
 }
@@ -46,6 +51,7 @@ TEST(AudioReaderTest, OggAudioFile) {
     parameters.windowstimesize_s = 20e-3;
     parameters.period_s = 1e-3;
     parameters.resample_rate_hz = 22050;
+    parameters.sample_format = SampleFormat::DOUBLE;
     audio_reader.initExtraction(parameters);
     ExtractBuffers(audio_reader);
 }
@@ -59,6 +65,7 @@ TEST(AudioReaderTest, Mp3AudioFile) {
     parameters.windowstimesize_s = 20e-3;
     parameters.period_s = 1e-3;
     parameters.resample_rate_hz = -1;
+    parameters.sample_format = SampleFormat::DOUBLE;
     audio_reader.initExtraction(parameters);
     ExtractBuffers(audio_reader);
 }
@@ -72,6 +79,7 @@ TEST(AudioReaderTest, FlacAudioFile) {
     parameters.windowstimesize_s = 50e-3;
     parameters.period_s = 1e-3;
     parameters.resample_rate_hz = 8000;
+    parameters.sample_format = SampleFormat::DOUBLE;
     audio_reader.initExtraction(parameters);
     ExtractBuffers(audio_reader);
 }
@@ -85,6 +93,7 @@ TEST(AudioReaderTest, Mp3MonoAudioFile) {
     parameters.windowstimesize_s = 40e-3;
     parameters.period_s = 3e-3;
     parameters.resample_rate_hz = 48000;
+    parameters.sample_format = SampleFormat::DOUBLE;
     audio_reader.initExtraction(parameters);
     ExtractBuffers(audio_reader);
 }
@@ -98,6 +107,7 @@ TEST(AudioReaderTest, Ogg5ChannelsAudioFile) {
     parameters.windowstimesize_s = 200e-3;
     parameters.period_s = 10e-3;
     parameters.resample_rate_hz = 44100;
+    parameters.sample_format = SampleFormat::DOUBLE;
     audio_reader.initExtraction(parameters);
     ExtractBuffers(audio_reader);
 }
@@ -111,6 +121,225 @@ TEST(AudioReaderTest, Ac35_1AudioFile) {
     parameters.windowstimesize_s = 20e-3;
     parameters.period_s = 1e-3;
     parameters.resample_rate_hz = 44100;
+    parameters.sample_format = SampleFormat::DOUBLE;
     audio_reader.initExtraction(parameters, 0);
     ExtractBuffers(audio_reader);
 }
+
+
+TEST(AudioReaderTest, FastProbe) {
+    std::vector<std::string> filepaths = {"../../../tests/sound_samples/whistling_stereo.wav",
+                                          "../../../tests/sound_samples/whistling_stereo.flac",
+                                          "../../../tests/sound_samples/whistling_stereo.ogg",
+                                          "../../../tests/sound_samples/whistling_stereo.mp3",
+                                          "../../../tests/sound_samples/5_1_sound.ac3"};
+    for(auto & filepath : filepaths) {
+        // Metadata against the decoding of the whole stream
+        FFmpegAudioReader audio_reader_fast(filepath, ProbeMode::FAST);
+        FFmpegAudioReader audio_reader_exact(filepath, ProbeMode::EXACT);
+        ASSERT_EQ(audio_reader_fast.getNumberOfStream(), audio_reader_exact.getNumberOfStream());
+        for(unsigned int k = 0; k < audio_reader_fast.getNumberOfStream(); k++) {
+            AudioStream stream_fast = audio_reader_fast.getStreams()[k];
+            AudioStream stream_exact = audio_reader_exact.getStreams()[k];
+            EXPECT_EQ(stream_fast.sample_rate_hz, stream_exact.sample_rate_hz) << filepath;
+            // Duration of the decoded samples (the duration of the EXACT mode also comes from the metadata)
+            double decoded_duration_s = (double)stream_exact.nb_samples / (double)stream_exact.sample_rate_hz;
+            EXPECT_NEAR(stream_fast.duration_s, decoded_duration_s, 100e-3) << filepath;
+            EXPECT_NEAR((double)stream_fast.nb_samples, (double)stream_exact.nb_samples,
+                        100e-3 * (double)stream_exact.sample_rate_hz) << filepath;
+        }
+    }
+}
+
+
+TEST(AudioReaderTest, TimeRange) {
+    std::string filepath = "../../../tests/sound_samples/whistling_stereo.wav";
+    FFmpegAudioReader audio_reader(filepath);
+    AudioReaderParameters parameters = DEFAULT_AUDIO_READER_PARAMETERS;
+    // Whole file
+    audio_reader.initExtraction(parameters);
+    std::vector<std::vector<double>> buffers;
+    std::vector<double> temp_buffer;
+    while(audio_reader.getNextBuffer(temp_buffer)) {
+        buffers.push_back(temp_buffer);
+    }
+    // From 1s to 2s: same buffers as the whole file, shifted by 1s
+    double timestart_s = 1.0;
+    double timestop_s = 2.0;
+    audio_reader.initExtraction(parameters, 0, timestart_s, timestop_s);
+    size_t offset = (size_t)round(timestart_s / parameters.period_s);
+    size_t nb_buffers = 0;
+    while(audio_reader.getNextBuffer(temp_buffer)) {
+        ASSERT_LT(offset + nb_buffers, buffers.size());
+        ASSERT_EQ(temp_buffer.size(), buffers[offset + nb_buffers].size());
+        for(size_t k = 0; k < temp_buffer.size(); k++) {
+            EXPECT_NEAR(temp_buffer[k], buffers[offset + nb_buffers][k], 1e-6);
+        }
+        nb_buffers++;
+    }
+    size_t nb_buffers_expected = (size_t)floor((timestop_s - timestart_s - parameters.windowstimesize_s) / parameters.period_s) + 1;
+    EXPECT_LE(abs((int64_t)nb_buffers - (int64_t)nb_buffers_expected), 1);
+    // Invalid time range
+    EXPECT_THROW(audio_reader.initExtraction(parameters, 0, 2.0, 1.0), std::runtime_error);
+}
+
+
+TEST(AudioReaderTest, LossyTimeRange) {
+    std::vector<std::string> filepaths = {"../../../tests/sound_samples/whistling_stereo.mp3",
+                                          "../../../tests/sound_samples/whistling_stereo.ogg"};
+    for(auto & filepath : filepaths) {
+        FFmpegAudioReader audio_reader(filepath);
+        AudioReaderParameters parameters = DEFAULT_AUDIO_READER_PARAMETERS;
+        audio_reader.initExtraction(parameters);
+        std::vector<std::vector<double>> buffers;
+        std::vector<double> temp_buffer;
+        while(audio_reader.getNextBuffer(temp_buffer)) {
+            buffers.push_back(temp_buffer);
+        }
+        uint64_t nb_frames_whole = audio_reader.getNumberOfDecodedFrames();
+        // Last quarter of the file: decoded from a keyframe before the range, not from the beginning
+        double duration_s = audio_reader.getStreams()[0].duration_s;
+        double timestart_s = round(0.75 * duration_s / parameters.period_s) * parameters.period_s;
+        audio_reader.initExtraction(parameters, 0, timestart_s);
+        size_t offset = (size_t)round(timestart_s / parameters.period_s);
+        size_t nb_buffers = 0;
+        while(audio_reader.getNextBuffer(temp_buffer)) {
+            ASSERT_LT(offset + nb_buffers, buffers.size()) << filepath;
+            ASSERT_EQ(temp_buffer.size(), buffers[offset + nb_buffers].size());
+            for(size_t k = 0; k < temp_buffer.size(); k++) {
+                EXPECT_NEAR(temp_buffer[k], buffers[offset + nb_buffers][k], 1e-4) << filepath;
+            }
+            nb_buffers++;
+        }
+        EXPECT_GT(nb_buffers, 0) << filepath;
+        EXPECT_LT(audio_reader.getNumberOfDecodedFrames(), nb_frames_whole / 2) << filepath;
+    }
+}
+
+
+TEST(AudioReaderTest, BufferView) {
+    std::string filepath = "../../../tests/sound_samples/whistling_stereo.flac";
+    FFmpegAudioReader audio_reader(filepath);
+    AudioReaderParameters parameters = DEFAULT_AUDIO_READER_PARAMETERS;
+    audio_reader.initExtraction(parameters);
+    std::vector<std::vector<double>> buffers;
+    std::vector<double> temp_buffer;
+    while(audio_reader.getNextBuffer(temp_buffer)) {
+        buffers.push_back(temp_buffer);
+    }
+    // Same windows given in place
+    audio_reader.initExtraction(parameters);
+    BufferView<double> view;
+    size_t nb_buffers = 0;
+    while(audio_reader.getNextBufferView(view)) {
+        ASSERT_LT(nb_buffers, buffers.size());
+        ASSERT_EQ(view.size, buffers[nb_buffers].size());
+        EXPECT_TRUE(std::equal(view.samples, view.samples + view.size, buffers[nb_buffers].begin()));
+        nb_buffers++;
+    }
+    EXPECT_EQ(nb_buffers, buffers.size());
+    // The type of the view must match the sample format
+    BufferView<float> view_float;
+    audio_reader.initExtraction(parameters);
+    EXPECT_THROW(audio_reader.getNextBufferView(view_float), std::runtime_error);
+}
+
+
+TEST(AudioReaderTest, NoAllocationInSteadyState) {
+    // Buffers of the reader only (the packets and frames of FFmpeg are not counted)
+    std::vector<std::string> filepaths = {"../../../tests/sound_samples/whistling_stereo.wav",
+                                          "../../../tests/sound_samples/whistling_stereo.mp3"};
+    for(auto & filepath : filepaths) {
+        FFmpegAudioReader audio_reader(filepath);
+        AudioReaderParameters parameters = DEFAULT_AUDIO_READER_PARAMETERS;
+        parameters.resample_rate_hz = 44100;
+        audio_reader.initExtraction(parameters);
+        BufferView<double> view;
+        // Buffers sized by the first frames
+        for(unsigned int k = 0; k < 1000; k++) {
+            ASSERT_TRUE(audio_reader.getNextBufferView(view));
+        }
+        uint64_t nb_allocations = audio_reader.getNumberOfAllocations();
+        EXPECT_GT(nb_allocations, 0);
+        while(audio_reader.getNextBufferView(view)) {
+        }
+        EXPECT_EQ(audio_reader.getNumberOfAllocations(), nb_allocations) << filepath;
+    }
+}
+
+
+TEST(AudioReaderTest, AutoSampleRate) {
+    std::string filepath = "../../../tests/sound_samples/440Hz_44100Hz_16bit_05sec.wav";
+    FFmpegAudioReader audio_reader(filepath);
+    AudioReaderParameters parameters = DEFAULT_AUDIO_READER_PARAMETERS;
+    parameters.resample_rate_hz = AUTO_SAMPLE_RATE;
+    // Lowest standard rate keeping the maximum frequency, never above the rate of the stream
+    parameters.max_frequency_hz = 4200.0;
+    audio_reader.initExtraction(parameters);
+    EXPECT_EQ(audio_reader.getOutputSampleRate(), 11025);
+    parameters.max_frequency_hz = 1000.0;
+    audio_reader.initExtraction(parameters);
+    EXPECT_EQ(audio_reader.getOutputSampleRate(), 8000);
+    parameters.max_frequency_hz = 30000.0;
+    audio_reader.initExtraction(parameters);
+    EXPECT_EQ(audio_reader.getOutputSampleRate(), 44100);
+    // The decimated signal keeps the pitch
+    parameters.max_frequency_hz = 1000.0;
+    audio_reader.initExtraction(parameters);
+    McLeodPitchExtractorMethod mcleod_method;
+    std::vector<double> buffer;
+    unsigned int nb_buffers = 0;
+    while(audio_reader.getNextBuffer(buffer)) {
+        if((nb_buffers++ % 100) == 0) {
+            EXPECT_NEAR(mcleod_method.get_pitch(buffer, (double)audio_reader.getOutputSampleRate()), 440.0, 2.0);
+        }
+    }
+    EXPECT_GT(nb_buffers, 0);
+}
+
+
+TEST(AudioReaderTest, MemoryAndStreamInputs) {
+    std::string filepath = "../../../tests/sound_samples/whistling_stereo.mp3";
+    FFmpegAudioReader file_audio_reader(filepath);
+    AudioReaderParameters parameters = DEFAULT_AUDIO_READER_PARAMETERS;
+    file_audio_reader.initExtraction(parameters, 0, 1.0, 2.0);
+    std::vector<std::vector<double>> buffers;
+    std::vector<double> temp_buffer;
+    while(file_audio_reader.getNextBuffer(temp_buffer)) {
+        buffers.push_back(temp_buffer);
+    }
+    // Content of the file in memory and as a stream: same streams and same buffers
+    std::ifstream file(filepath, std::ios::binary);
+    std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::ifstream stream(filepath, std::ios::binary);
+    std::vector<std::shared_ptr<AudioInput>> inputs = {std::make_shared<AudioInput>(bytes.data(), bytes.size()),
+                                                       std::make_shared<AudioInput>(stream)};
+    for(auto & input : inputs) {
+        FFmpegAudioReader audio_reader(input);
+        EXPECT_EQ(audio_reader.getFilePath(), input->getName());
+        ASSERT_EQ(audio_reader.getNumberOfStream(), file_audio_reader.getNumberOfStream());
+        EXPECT_EQ(audio_reader.getStreams()[0].nb_samples, file_audio_reader.getStreams()[0].nb_samples);
+        // The stream is not read until its end by the probing (number of samples of the Xing header)
+        EXPECT_EQ(input->getSize(), input->isStream() ? -1 : (int64_t)bytes.size());
+        // Twice: the input is read again from the beginning
+        for(unsigned int k = 0; k < 2; k++) {
+            audio_reader.initExtraction(parameters, 0, 1.0, 2.0);
+            size_t nb_buffers = 0;
+            while(audio_reader.getNextBuffer(temp_buffer)) {
+                ASSERT_LT(nb_buffers, buffers.size());
+                EXPECT_EQ(temp_buffer, buffers[nb_buffers]);
+                nb_buffers++;
+            }
+            EXPECT_EQ(nb_buffers, buffers.size());
+        }
+        // Clones read the same input
+        std::unique_ptr<AudioReader> clone = audio_reader.clone();
+        clone->initExtraction(parameters, 0, 1.0, 2.0);
+        clone->selectWindows(10);
+        ASSERT_TRUE(clone->getNextBuffer(temp_buffer));
+        EXPECT_EQ(temp_buffer, buffers[10]);
+    }
+    // Not a multimedia content
+    std::vector<uint8_t> garbage(1000, 42);
+    EXPECT_THROW(FFmpegAudioReader(std::make_shared<AudioInput>(garbage.data(), garbage.size())), std::runtime_error);
+}
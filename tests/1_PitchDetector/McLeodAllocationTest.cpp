@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstdlib>
+#include <new>
+#include <vector>
+#include "McLeodPitchExtractorMethod.hpp"
+
+
+
+// Heap allocations of the current thread, counted while count_allocations is set
+// (this file is built in its own test program, run_allocation_tests, so that the
+// replaced allocation functions do not apply to the other tests)
+static thread_local bool count_allocations = false;
+static thread_local uint64_t nb_allocations = 0;
+
+void * operator new(std::size_t size) {
+    if(count_allocations) {
+        nb_allocations++;
+    }
+    void * ptr = std::malloc((size == 0) ? 1 : size);
+    if(ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void * ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void * ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+
+template<typename T>
+uint64_t countExtractionAllocations(McLeodPitchExtractorMethod & mcleod_method, const std::vector<T> & signal,
+                                    size_t window_size, size_t hop_size, double sample_rate_hz) {
+    size_t nb_windows = (signal.size() - window_size) / hop_size + 1;
+    std::vector<std::vector<T>> buffers;
+    for(size_t k = 0; k < nb_windows; k++) {
+        buffers.emplace_back(signal.begin() + k * hop_size, signal.begin() + k * hop_size + window_size);
+    }
+    std::vector<double> pitches(nb_windows);
+    std::vector<double> energies(nb_windows);
+    WindowBatch<T> batch = {signal.data(), window_size, (double)hop_size, 0, nb_windows};
+    McLeodWorkspace workspace;
+    uint64_t result = 0;
+    // The first pass sizes the workspaces, the second one must not allocate
+    for(int pass = 0; pass < 2; pass++) {
+        nb_allocations = 0;
+        count_allocations = (pass == 1);
+        for(size_t k = 0; k < nb_windows; k++) {
+            pitches[k] = mcleod_method.get_pitch(buffers[k], sample_rate_hz);
+            pitches[k] = mcleod_method.get_pitch(buffers[k], sample_rate_hz, workspace);
+        }
+        mcleod_method.get_pitches(batch, sample_rate_hz, pitches.data(), energies.data());
+        mcleod_method.get_pitches(batch, sample_rate_hz, pitches.data(), energies.data(), workspace);
+        count_allocations = false;
+        result = nb_allocations;
+    }
+    return result;
+}
+
+TEST(McLeodPitchExtractorMethodTest, NoAllocationInSteadyState) {
+    const double pi = 3.14159265358979323846;
+    double sample_rate_hz = 44100;
+    std::vector<double> signal(8820);
+    for(size_t k = 0; k < signal.size(); k++) {
+        double freq = 200.0 + 200.0 * k / signal.size();
+        signal[k] = sin(2 * pi * freq * k / sample_rate_hz);
+    }
+    std::vector<float> signal_float(signal.begin(), signal.end());
+    for(auto method : {NsdfMethod::DIRECT, NsdfMethod::FFT, NsdfMethod::INCREMENTAL}) {
+        McLeodParameters parameters = DEFAULT_MC_LEOD_PARAMETERS;
+        parameters.nsdf_method = method;
+        McLeodPitchExtractorMethod mcleod_method(parameters);
+        EXPECT_EQ(countExtractionAllocations(mcleod_method, signal, 882, 44, sample_rate_hz), 0);
+        EXPECT_EQ(countExtractionAllocations(mcleod_method, signal_float, 882, 44, sample_rate_hz), 0);
+    }
+}
@@ -4,6 +4,7 @@
 #include <vector>
 #include "McLeodPitchExtractorMethod.hpp"
 
+
 TEST(McLeodPitchExtractorMethodTest, CorrectExtractedFrequency) {
     // Declare a pitch extractor method
     McLeodPitchExtractorMethod mcleod_method;
@@ -24,3 +25,302 @@ TEST(McLeodPitchExtractorMethodTest, CorrectExtractedFrequency) {
         EXPECT_TRUE(std::abs(freq_estimated - freq) < 3);
     }
 }
+
+
+TEST(McLeodPitchExtractorMethodTest, FFTMatchesDirectMethod) {
+    McLeodParameters parameters = DEFAULT_MC_LEOD_PARAMETERS;
+    parameters.nsdf_method = NsdfMethod::DIRECT;
+    McLeodPitchExtractorMethod direct_method(parameters);
+    parameters.nsdf_method = NsdfMethod::FFT;
+    McLeodPitchExtractorMethod fft_method(parameters);
+    // Harmonic signal with some deterministic noise
+    const double pi = 3.14159265358979323846;
+    double sample_rate_hz = 44100;
+    std::vector<double> frequencies = {130.8, 196.0, 440.0, 1318.5};
+    std::vector<double> audio_buffer(882);
+    unsigned int seed = 12345;
+    for(auto &freq : frequencies) {
+        for(unsigned int k=0; k< audio_buffer.size(); k++) {
+            seed = seed * 1103515245 + 12345;
+            double noise = ((seed >> 16) % 1000) / 1000.0 - 0.5;
+            audio_buffer[k] = sin(2*pi*freq*k/sample_rate_hz) + 0.5*sin(4*pi*freq*k/sample_rate_hz) + 0.05*noise;
+        }
+        double freq_direct = direct_method.get_pitch(audio_buffer, sample_rate_hz);
+        double freq_fft = fft_method.get_pitch(audio_buffer, sample_rate_hz);
+        EXPECT_NEAR(freq_direct, freq_fft, 1e-6);
+        EXPECT_TRUE(std::abs(freq_fft - freq) < 3);
+    }
+}
+
+TEST(McLeodPitchExtractorMethodTest, FFTMatchesDirectNsdf) {
+    McLeodParameters parameters = DEFAULT_MC_LEOD_PARAMETERS;
+    parameters.lower_pitch_cutoff = 0.0;
+    parameters.nsdf_method = NsdfMethod::DIRECT;
+    McLeodPitchExtractorMethod direct_method(parameters);
+    parameters.nsdf_method = NsdfMethod::FFT;
+    McLeodPitchExtractorMethod fft_method(parameters);
+    const double pi = 3.14159265358979323846;
+    double sample_rate_hz = 44100;
+    unsigned int seed = 4321;
+    for(size_t buffer_size : {2, 100, 882, 1024, 2049}) {
+        std::vector<double> audio_buffer(buffer_size);
+        for(size_t k = 0; k < buffer_size; k++) {
+            seed = seed * 1103515245 + 12345;
+            double noise = ((seed >> 16) % 1000) / 1000.0 - 0.5;
+            audio_buffer[k] = 0.8*sin(2*pi*220.0*k/sample_rate_hz) + 0.3*sin(2*pi*660.0*k/sample_rate_hz) + 0.1*noise + 0.2;
+        }
+        std::vector<double> nsdf_direct;
+        std::vector<double> nsdf_fft;
+        direct_method.get_nsdf(audio_buffer, nsdf_direct);
+        fft_method.get_nsdf(audio_buffer, nsdf_fft);
+        ASSERT_EQ(nsdf_direct.size(), buffer_size);
+        ASSERT_EQ(nsdf_fft.size(), buffer_size);
+        EXPECT_EQ(nsdf_fft[0], 1.0);
+        for(size_t tau = 0; tau < buffer_size; tau++) {
+            EXPECT_NEAR(nsdf_direct[tau], nsdf_fft[tau], 1e-10) << buffer_size << " " << tau;
+        }
+    }
+}
+
+TEST(McLeodPitchExtractorMethodTest, IncrementalMatchesDirectMethod) {
+    McLeodParameters parameters = DEFAULT_MC_LEOD_PARAMETERS;
+    parameters.nsdf_method = NsdfMethod::DIRECT;
+    McLeodPitchExtractorMethod direct_method(parameters);
+    parameters.nsdf_method = NsdfMethod::INCREMENTAL;
+    McLeodPitchExtractorMethod incremental_method(parameters);
+    // Glissando followed by silence then a new note
+    const double pi = 3.14159265358979323846;
+    double sample_rate_hz = 44100;
+    double period_s = 1e-3;
+    size_t window_size = 882;
+    std::vector<double> signal(44100);
+    double phase = 0.0;
+    for(size_t k = 0; k < signal.size(); k++) {
+        double freq = 200.0 + 400.0 * k / signal.size();
+        phase += 2 * pi * freq / sample_rate_hz;
+        bool silence = (k > 20000) && (k < 25000);
+        signal[k] = silence ? 0.0 : sin(phase) + 0.3 * sin(3 * phase);
+    }
+    double hop_size = period_s * sample_rate_hz;
+    size_t nb_windows = 0;
+    while(get_window_start(hop_size, nb_windows) + window_size <= signal.size()) {
+        nb_windows++;
+    }
+    // Consecutive batches given to the same workspace: the lag products slide from one batch to the next
+    std::vector<double> pitches(nb_windows);
+    std::vector<double> energies(nb_windows);
+    McLeodWorkspace workspace;
+    size_t batch_size = 100;
+    for(size_t first_window = 0; first_window < nb_windows; first_window += batch_size) {
+        size_t nb_batch_windows = std::min(batch_size, nb_windows - first_window);
+        WindowBatch<double> batch = {signal.data() + get_window_start(hop_size, first_window), window_size, hop_size, first_window, nb_batch_windows};
+        incremental_method.get_pitches(batch, sample_rate_hz, pitches.data() + first_window, energies.data() + first_window, workspace);
+        if(first_window > 0) {
+            EXPECT_GT(workspace.stream.nb_updates, 0);
+        }
+    }
+    std::vector<double> audio_buffer(window_size);
+    for(size_t ind = 0; ind < nb_windows; ind++) {
+        int64_t start = get_window_start(hop_size, ind);
+        audio_buffer.assign(signal.begin() + start, signal.begin() + start + window_size);
+        double freq_direct = direct_method.get_pitch(audio_buffer, sample_rate_hz);
+        if(std::isnan(freq_direct)) {
+            EXPECT_TRUE(std::isnan(pitches[ind]));
+        } else {
+            EXPECT_NEAR(freq_direct, pitches[ind], 1e-4);
+        }
+    }
+    // A batch which does not follow the previous one starts from an exact computation
+    WindowBatch<double> batch = {signal.data(), window_size, hop_size, 0, 1};
+    incremental_method.get_pitches(batch, sample_rate_hz, pitches.data(), energies.data(), workspace);
+    EXPECT_EQ(workspace.stream.nb_updates, 0);
+    EXPECT_NEAR(direct_method.get_pitch(std::vector<double>(signal.begin(), signal.begin() + window_size), sample_rate_hz), pitches[0], 1e-9);
+}
+
+TEST(McLeodPitchExtractorMethodTest, BoundedLagRangeMatchesFullRange) {
+    // Search without pitch limits
+    McLeodParameters parameters = DEFAULT_MC_LEOD_PARAMETERS;
+    parameters.lower_pitch_cutoff = 0.0;
+    parameters.upper_pitch_cutoff = 0.0;
+    // Vocal range search
+    McLeodParameters bounded_parameters = DEFAULT_MC_LEOD_PARAMETERS;
+    bounded_parameters.lower_pitch_cutoff = 80.0;
+    bounded_parameters.upper_pitch_cutoff = 1100.0;
+    const double pi = 3.14159265358979323846;
+    double sample_rate_hz = 44100;
+    std::vector<double> frequencies = {110.0, 146.8, 233.1, 440.0, 587.3, 1046.5};
+    std::vector<double> audio_buffer(1764);
+    for(auto method : {NsdfMethod::DIRECT, NsdfMethod::FFT, NsdfMethod::INCREMENTAL}) {
+        parameters.nsdf_method = method;
+        bounded_parameters.nsdf_method = method;
+        McLeodPitchExtractorMethod full_method(parameters);
+        McLeodPitchExtractorMethod bounded_method(bounded_parameters);
+        for(auto &freq : frequencies) {
+            for(unsigned int k=0; k< audio_buffer.size(); k++) {
+                double phase = 2*pi*freq*k/sample_rate_hz;
+                audio_buffer[k] = sin(phase) + 0.4*sin(2*phase) + 0.2*sin(3*phase);
+            }
+            double freq_full = full_method.get_pitch(audio_buffer, sample_rate_hz);
+            double freq_bounded = bounded_method.get_pitch(audio_buffer, sample_rate_hz);
+            EXPECT_EQ(freq_full, freq_bounded);
+            EXPECT_TRUE(std::abs(freq_bounded - freq) < 3);
+            // Batch of a single window
+            WindowBatch<double> batch = {audio_buffer.data(), audio_buffer.size(), 1.0, 0, 1};
+            double freq_full_batch, freq_bounded_batch, energy;
+            full_method.get_pitches(batch, sample_rate_hz, &freq_full_batch, &energy);
+            bounded_method.get_pitches(batch, sample_rate_hz, &freq_bounded_batch, &energy);
+            EXPECT_NEAR(freq_full_batch, freq_bounded_batch, 1e-9);
+        }
+    }
+}
+
+TEST(McLeodPitchExtractorMethodTest, NoisyWindowsMatchFullRange) {
+    // The pitch limits only reject the pitches found without them: the threshold of the peaks
+    // depends on the peaks of all the lags (noisy and inharmonic windows with peaks at long lags)
+    McLeodParameters parameters = DEFAULT_MC_LEOD_PARAMETERS;
+    parameters.lower_pitch_cutoff = 0.0;
+    parameters.upper_pitch_cutoff = 0.0;
+    McLeodParameters bounded_parameters = DEFAULT_MC_LEOD_PARAMETERS;
+    bounded_parameters.lower_pitch_cutoff = 150.0;
+    bounded_parameters.upper_pitch_cutoff = 1100.0;
+    const double pi = 3.14159265358979323846;
+    double sample_rate_hz = 44100;
+    std::vector<double> audio_buffer(882);
+    unsigned int seed = 1234;
+    for(auto method : {NsdfMethod::DIRECT, NsdfMethod::FFT}) {
+        parameters.nsdf_method = method;
+        bounded_parameters.nsdf_method = method;
+        McLeodPitchExtractorMethod full_method(parameters);
+        McLeodPitchExtractorMethod bounded_method(bounded_parameters);
+        size_t nb_pitches = 0;
+        for(unsigned int w = 0; w < 500; w++) {
+            double freq = 100.0 + (double)(w % 50) * 4.0;
+            double noise_amplitude = 0.2 * (double)(w % 7);
+            for(size_t k = 0; k < audio_buffer.size(); k++) {
+                seed = seed * 1103515245 + 12345;
+                double noise = ((seed >> 16) % 1000) / 1000.0 - 0.5;
+                double phase = 2*pi*freq*k/sample_rate_hz;
+                audio_buffer[k] = sin(phase) + 0.5*sin(2.03*phase) + 0.3*sin(3.1*phase) + noise_amplitude*noise;
+            }
+            double freq_full = full_method.get_pitch(audio_buffer, sample_rate_hz);
+            double freq_bounded = bounded_method.get_pitch(audio_buffer, sample_rate_hz);
+            if((freq_full > 150.0) && (freq_full < 1100.0)) {
+                EXPECT_EQ(freq_bounded, freq_full) << w;
+                nb_pitches++;
+            } else {
+                EXPECT_TRUE(std::isnan(freq_bounded)) << w << " " << freq_full << " " << freq_bounded;
+            }
+        }
+        // Both accepted and rejected windows
+        EXPECT_GT(nb_pitches, 50);
+        EXPECT_LT(nb_pitches, 450);
+    }
+}
+
+TEST(McLeodPitchExtractorMethodTest, PitchOutsideLimits) {
+    McLeodParameters parameters = DEFAULT_MC_LEOD_PARAMETERS;
+    parameters.lower_pitch_cutoff = 150.0;
+    parameters.upper_pitch_cutoff = 1000.0;
+    McLeodPitchExtractorMethod mcleod_method(parameters);
+    const double pi = 3.14159265358979323846;
+    double sample_rate_hz = 44100;
+    std::vector<double> audio_buffer(1764);
+    for(double freq : {100.0, 2000.0}) {
+        for(unsigned int k=0; k< audio_buffer.size(); k++) {
+            audio_buffer[k] = sin(2*pi*freq*k/sample_rate_hz);
+        }
+        EXPECT_TRUE(std::isnan(mcleod_method.get_pitch(audio_buffer, sample_rate_hz)));
+    }
+}
+
+TEST(McLeodPitchExtractorMethodTest, SinglePrecisionMatchesDoublePrecision) {
+    const double pi = 3.14159265358979323846;
+    double sample_rate_hz = 44100;
+    double period_s = 1e-3;
+    size_t window_size = 882;
+    // Glissando with some deterministic noise
+    std::vector<double> signal(22050);
+    double phase = 0.0;
+    unsigned int seed = 12345;
+    for(size_t k = 0; k < signal.size(); k++) {
+        double freq = 100.0 + 900.0 * k / signal.size();
+        phase += 2 * pi * freq / sample_rate_hz;
+        seed = seed * 1103515245 + 12345;
+        double noise = ((seed >> 16) % 1000) / 1000.0 - 0.5;
+        signal[k] = 0.5 * sin(phase) + 0.2 * sin(2 * phase) + 0.01 * noise;
+    }
+    for(auto method : {NsdfMethod::DIRECT, NsdfMethod::FFT, NsdfMethod::INCREMENTAL}) {
+        McLeodParameters parameters = DEFAULT_MC_LEOD_PARAMETERS;
+        parameters.nsdf_method = method;
+        McLeodPitchExtractorMethod mcleod_method(parameters);
+        double hop_size = period_s * sample_rate_hz;
+        size_t nb_windows = 0;
+        while(get_window_start(hop_size, nb_windows) + window_size <= signal.size()) {
+            nb_windows++;
+        }
+        std::vector<float> signal_float(signal.begin(), signal.end());
+        WindowBatch<double> double_batch = {signal.data(), window_size, hop_size, 0, nb_windows};
+        WindowBatch<float> float_batch = {signal_float.data(), window_size, hop_size, 0, nb_windows};
+        std::vector<double> double_pitches(nb_windows);
+        std::vector<double> float_pitches(nb_windows);
+        std::vector<double> energies(nb_windows);
+        mcleod_method.get_pitches(double_batch, sample_rate_hz, double_pitches.data(), energies.data());
+        mcleod_method.get_pitches(float_batch, sample_rate_hz, float_pitches.data(), energies.data());
+        unsigned int nb_pitches = 0;
+        for(size_t ind = 0; ind < nb_windows; ind++) {
+            double freq_double = double_pitches[ind];
+            double freq_float = float_pitches[ind];
+            EXPECT_EQ(std::isnan(freq_double), std::isnan(freq_float));
+            if(!std::isnan(freq_double) && !std::isnan(freq_float)) {
+                // Difference in semitones
+                EXPECT_NEAR(12.0 * log2(freq_float / freq_double), 0.0, 0.01);
+                nb_pitches++;
+            }
+        }
+        EXPECT_GT(nb_pitches, 0);
+    }
+}
+
+TEST(McLeodPitchExtractorMethodTest, BatchMatchesPerWindow) {
+    const double pi = 3.14159265358979323846;
+    double sample_rate_hz = 44100;
+    // Fractional hop (1 ms at 44.1 kHz) and a batch not starting at the first window of the stream
+    double hop_size = 44.1;
+    uint64_t first_window = 7;
+    size_t window_size = 882;
+    size_t nb_windows = 300;
+    std::vector<double> signal(get_window_start(hop_size, first_window + nb_windows - 1) - get_window_start(hop_size, first_window) + window_size);
+    double phase = 0.0;
+    for(size_t k = 0; k < signal.size(); k++) {
+        double freq = 150.0 + 600.0 * k / signal.size();
+        phase += 2 * pi * freq / sample_rate_hz;
+        signal[k] = sin(phase) + 0.3 * sin(2 * phase);
+    }
+    std::vector<float> signal_float(signal.begin(), signal.end());
+    WindowBatch<double> batch = {signal.data(), window_size, hop_size, first_window, nb_windows};
+    WindowBatch<float> batch_float = {signal_float.data(), window_size, hop_size, first_window, nb_windows};
+    EXPECT_EQ(signal.size(), batch.getNumberOfSamples());
+    for(auto method : {NsdfMethod::DIRECT, NsdfMethod::FFT, NsdfMethod::INCREMENTAL}) {
+        McLeodParameters parameters = DEFAULT_MC_LEOD_PARAMETERS;
+        parameters.nsdf_method = method;
+        McLeodPitchExtractorMethod mcleod_method(parameters);
+        std::vector<double> pitches(nb_windows);
+        std::vector<double> energies(nb_windows);
+        std::vector<double> pitches_float(nb_windows);
+        std::vector<double> energies_float(nb_windows);
+        mcleod_method.get_pitches(batch, sample_rate_hz, pitches.data(), energies.data());
+        mcleod_method.get_pitches(batch_float, sample_rate_hz, pitches_float.data(), energies_float.data());
+        for(size_t k = 0; k < nb_windows; k++) {
+            size_t start = batch.getWindowStart(k);
+            std::vector<double> audio_buffer(signal.begin() + start, signal.begin() + start + window_size);
+            double energy = 0.0;
+            for(auto & sample : audio_buffer) {
+                energy += sample * sample;
+            }
+            EXPECT_NEAR(mcleod_method.get_pitch(audio_buffer, sample_rate_hz), pitches[k], 1e-4);
+            EXPECT_NEAR(energy / window_size, energies[k], 1e-12);
+            EXPECT_NEAR(12.0 * log2(pitches_float[k] / pitches[k]), 0.0, 0.01);
+            EXPECT_NEAR(energies_float[k], energies[k], 1e-5);
+        }
+    }
+}
@@ -13,10 +13,13 @@ TEST(PitchDetectorTest, Basic) {
     reader_parameters.windowstimesize_s = 20e-3;
     reader_parameters.period_s = 1e-3;
     reader_parameters.resample_rate_hz = 44100;
+    reader_parameters.sample_format = SampleFormat::DOUBLE;
     McLeodParameters mcleod_parameters;
     mcleod_parameters.cutoff = 0.97;
     mcleod_parameters.small_cutoff = 0.5;
     mcleod_parameters.lower_pitch_cutoff = 50.0;
+    mcleod_parameters.upper_pitch_cutoff = 0.0;
+    mcleod_parameters.nsdf_method = NsdfMethod::FFT;
     // Audio reader
     FFmpegAudioReader audio_reader(filepath);
     // Pitch extractor method
@@ -40,3 +43,69 @@ TEST(PitchDetectorTest, Basic) {
         }
     }
 }
+
+TEST(PitchDetectorTest, SinglePrecision) {
+    std::string filepath = "../../../tests/sound_samples/whistling_stereo.wav";
+    AudioReaderParameters reader_parameters = DEFAULT_AUDIO_READER_PARAMETERS;
+    reader_parameters.resample_rate_hz = 44100;
+    FFmpegAudioReader audio_reader(filepath);
+    McLeodPitchExtractorMethod mcleod_method(DEFAULT_MC_LEOD_PARAMETERS);
+    PitchDetector pitch_detector(&audio_reader, &mcleod_method);
+    std::atomic<float> progress(0.0);
+    reader_parameters.sample_format = SampleFormat::DOUBLE;
+    PitchResult result_double = pitch_detector.perform(&progress, reader_parameters);
+    reader_parameters.sample_format = SampleFormat::FLOAT;
+    PitchResult result_float = pitch_detector.perform(&progress, reader_parameters);
+    ASSERT_EQ(result_double.pitch_st.size(), result_float.pitch_st.size());
+    // Semitone output within a hundredth of a semitone where both precisions detect a pitch
+    unsigned int nb_mismatches = 0;
+    for(size_t k = 0; k < result_double.pitch_st.size(); k++) {
+        double pitch_double = result_double.pitch_st[k];
+        double pitch_float = result_float.pitch_st[k];
+        if(std::isnan(pitch_double) || std::isnan(pitch_float)) {
+            nb_mismatches += (std::isnan(pitch_double) != std::isnan(pitch_float)) ? 1 : 0;
+            continue;
+        }
+        EXPECT_NEAR(pitch_double, pitch_float, 0.01);
+        EXPECT_NEAR(result_double.energy[k], result_float.energy[k], 1e-4 * result_double.energy[k] + 1e-12);
+    }
+    // Only windows at the edge of the voicing decision can differ
+    EXPECT_LE(nb_mismatches, result_double.pitch_st.size() / 100);
+}
+
+// Pitch detection of a file with time segments decoded concurrently, compared to the sequential one
+// Lossy inputs: the decoder of a segment starts at a keyframe before it, its first samples can differ
+static void expectSegmentsMatchSequential(const std::string & filepath, const AudioReaderParameters & reader_parameters,
+                                          double pitch_tolerance_st=1e-9, double energy_tolerance=1e-12) {
+    FFmpegAudioReader audio_reader(filepath);
+    McLeodPitchExtractorMethod mcleod_method(DEFAULT_MC_LEOD_PARAMETERS);
+    PitchDetector pitch_detector(&audio_reader, &mcleod_method);
+    std::atomic<float> progress(0.0);
+    PitchResult result_sequential = pitch_detector.perform(&progress, reader_parameters);
+    pitch_detector.setNumberOfSegments(4);
+    PitchResult result_segments = pitch_detector.perform(&progress, reader_parameters);
+    ASSERT_EQ(result_sequential.pitch_st.size(), result_segments.pitch_st.size()) << filepath;
+    for(size_t k = 0; k < result_sequential.pitch_st.size(); k++) {
+        if(std::isnan(result_sequential.pitch_st[k])) {
+            EXPECT_TRUE(std::isnan(result_segments.pitch_st[k])) << filepath << " " << k;
+            continue;
+        }
+        EXPECT_NEAR(result_sequential.pitch_st[k], result_segments.pitch_st[k], pitch_tolerance_st) << filepath << " " << k;
+        EXPECT_NEAR(result_sequential.energy[k], result_segments.energy[k], energy_tolerance) << filepath << " " << k;
+    }
+}
+
+TEST(PitchDetectorTest, Segments) {
+    AudioReaderParameters reader_parameters = DEFAULT_AUDIO_READER_PARAMETERS;
+    // PCM input at its own sample rate: the segments are decoded exactly as the whole stream
+    expectSegmentsMatchSequential("../../../tests/sound_samples/whistling_stereo.wav", reader_parameters);
+    // Resampled PCM input: the resampler of each segment starts in phase with the one of the whole stream
+    reader_parameters.resample_rate_hz = AUTO_SAMPLE_RATE;
+    expectSegmentsMatchSequential("../../../tests/sound_samples/whistling_stereo.wav", reader_parameters);
+    // Lossy inputs (seek to a keyframe and preroll of the decoder), at their own sample rate and resampled
+    for(int64_t resample_rate_hz : {SAME_SAMPLE_RATE, AUTO_SAMPLE_RATE}) {
+        reader_parameters.resample_rate_hz = resample_rate_hz;
+        expectSegmentsMatchSequential("../../../tests/sound_samples/whistling_mono.mp3", reader_parameters, 1e-3, 1e-6);
+        expectSegmentsMatchSequential("../../../tests/sound_samples/whistling_stereo.ogg", reader_parameters, 1e-3, 1e-6);
+    }
+}
@@ -0,0 +1,197 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "WavAudioReader.hpp"
+#include "FFmpegAudioReader.hpp"
+#include "AudioReaderFactory.hpp"
+#include "McLeodPitchExtractorMethod.hpp"
+
+
+static void writeLE(std::ofstream & file, uint32_t value, size_t nb_bytes) {
+    for(size_t k = 0; k < nb_bytes; k++) {
+        file.put((char)((value >> (8 * k)) & 0xFF));
+    }
+}
+
+
+// Stereo WAV file of a sine (left) and of its opposite at half amplitude (right)
+static std::vector<double> writeWavFile(const std::string & filepath, uint16_t audio_format, uint16_t bits_per_sample,
+                                        uint32_t sample_rate_hz, size_t nb_frames) {
+    std::vector<double> left(nb_frames);
+    for(size_t k = 0; k < nb_frames; k++) {
+        left[k] = 0.5 * sin(2.0 * M_PI * 440.0 * (double)k / (double)sample_rate_hz);
+    }
+    uint16_t nb_channels = 2;
+    uint16_t block_align = (uint16_t)(nb_channels * bits_per_sample / 8);
+    uint32_t data_size = (uint32_t)(nb_frames * block_align);
+    std::ofstream file(filepath, std::ios::binary);
+    file.write("RIFF", 4);
+    writeLE(file, 4 + 8 + 16 + 8 + data_size, 4);
+    file.write("WAVEfmt ", 8);
+    writeLE(file, 16, 4);
+    writeLE(file, audio_format, 2);
+    writeLE(file, nb_channels, 2);
+    writeLE(file, sample_rate_hz, 4);
+    writeLE(file, sample_rate_hz * block_align, 4);
+    writeLE(file, block_align, 2);
+    writeLE(file, bits_per_sample, 2);
+    file.write("data", 4);
+    writeLE(file, data_size, 4);
+    for(size_t k = 0; k < nb_frames; k++) {
+        double channels[2] = {left[k], -0.5 * left[k]};
+        for(auto & sample : channels) {
+            if(audio_format == 3) {
+                float value = (float)sample;
+                uint32_t bits;
+                std::memcpy(&bits, &value, sizeof(float));
+                writeLE(file, bits, 4);
+            } else {
+                double scale = (double)(1u << (bits_per_sample - 1));
+                writeLE(file, (uint32_t)(int32_t)round(sample * scale), bits_per_sample / 8);
+            }
+        }
+    }
+    // Expected mono signal
+    std::vector<double> mono(nb_frames);
+    for(size_t k = 0; k < nb_frames; k++) {
+        mono[k] = 0.25 * left[k];
+    }
+    return mono;
+}
+
+
+TEST(WavAudioReaderTest, SampleFormats) {
+    std::string filepath = "wav_audio_reader_test.wav";
+    struct {uint16_t audio_format; uint16_t bits_per_sample; WavSampleFormat format; double tolerance;} cases[] = {
+        {1, 16, WavSampleFormat::PCM16, 1e-4},
+        {1, 24, WavSampleFormat::PCM24, 1e-6},
+        {3, 32, WavSampleFormat::FLOAT32, 1e-7}
+    };
+    for(auto & test_case : cases) {
+        std::vector<double> mono = writeWavFile(filepath, test_case.audio_format, test_case.bits_per_sample, 8000, 8000);
+        WavAudioReader audio_reader(filepath);
+        EXPECT_EQ(audio_reader.getWavSampleFormat(), test_case.format);
+        ASSERT_EQ(audio_reader.getNumberOfStream(), 1);
+        EXPECT_EQ(audio_reader.getStreams()[0].nb_samples, 8000);
+        EXPECT_EQ(audio_reader.getStreams()[0].nb_channels, 2);
+        AudioReaderParameters parameters = DEFAULT_AUDIO_READER_PARAMETERS;
+        audio_reader.initExtraction(parameters);
+        size_t window_size = (size_t)round(parameters.windowstimesize_s * 8000.0);
+        double hop_size = parameters.period_s * 8000.0;
+        std::vector<double> buffer;
+        uint64_t k = 0;
+        while(audio_reader.getNextBuffer(buffer)) {
+            ASSERT_EQ(buffer.size(), window_size);
+            size_t start = (size_t)get_window_start(hop_size, k);
+            for(size_t n = 0; n < window_size; n++) {
+                EXPECT_NEAR(buffer[n], mono[start + n], test_case.tolerance);
+            }
+            k++;
+        }
+        EXPECT_EQ(k, audio_reader.getExpectedNumberOfBuffers());
+    }
+    std::remove(filepath.c_str());
+}
+
+
+TEST(WavAudioReaderTest, SelectedWindows) {
+    std::string filepath = "wav_audio_reader_test.wav";
+    writeWavFile(filepath, 1, 16, 44100, 44100);
+    WavAudioReader audio_reader(filepath);
+    AudioReaderParameters parameters = DEFAULT_AUDIO_READER_PARAMETERS;
+    std::vector<std::vector<float>> buffers;
+    parameters.sample_format = SampleFormat::FLOAT;
+    audio_reader.initExtraction(parameters);
+    std::vector<float> buffer;
+    while(audio_reader.getNextBuffer(buffer)) {
+        buffers.push_back(buffer);
+    }
+    // A clone extracting a part of the windows gives the same buffers
+    std::unique_ptr<AudioReader> clone = audio_reader.clone();
+    clone->initExtraction(parameters);
+    clone->selectWindows(123, 456);
+    size_t nb_buffers = 0;
+    while(clone->getNextBuffer(buffer)) {
+        EXPECT_EQ(buffer, buffers[123 + nb_buffers]);
+        nb_buffers++;
+    }
+    EXPECT_EQ(nb_buffers, 456);
+    // Time range
+    audio_reader.initExtraction(parameters, 0, 0.5, 0.7);
+    nb_buffers = 0;
+    while(audio_reader.getNextBuffer(buffer)) {
+        EXPECT_EQ(buffer, buffers[500 + nb_buffers]);
+        nb_buffers++;
+    }
+    EXPECT_EQ(nb_buffers, 181);
+    std::remove(filepath.c_str());
+}
+
+
+TEST(WavAudioReaderTest, Resampling) {
+    std::string filepath = "wav_audio_reader_test.wav";
+    writeWavFile(filepath, 1, 16, 44100, 44100);
+    WavAudioReader audio_reader(filepath);
+    AudioReaderParameters parameters = DEFAULT_AUDIO_READER_PARAMETERS;
+    // Integer and fractional rate ratios
+    for(int64_t sample_rate_hz : {11025, 8000, 48000}) {
+        parameters.resample_rate_hz = sample_rate_hz;
+        audio_reader.initExtraction(parameters);
+        EXPECT_EQ(audio_reader.getOutputSampleRate(), sample_rate_hz);
+        size_t window_size = (size_t)round(parameters.windowstimesize_s * (double)sample_rate_hz);
+        double hop_size = parameters.period_s * (double)sample_rate_hz;
+        std::vector<std::vector<double>> buffers;
+        std::vector<double> buffer;
+        while(audio_reader.getNextBuffer(buffer)) {
+            ASSERT_EQ(buffer.size(), window_size);
+            buffers.push_back(buffer);
+        }
+        ASSERT_EQ(buffers.size(), audio_reader.getExpectedNumberOfBuffers());
+        // Sine away from the borders of the file (filter over the zeros around the file)
+        for(size_t k = 50; k + 50 < buffers.size(); k++) {
+            int64_t start = get_window_start(hop_size, k);
+            for(size_t n = 0; n < window_size; n++) {
+                double expected = 0.125 * sin(2.0 * M_PI * 440.0 * (double)(start + (int64_t)n) / (double)sample_rate_hz);
+                EXPECT_NEAR(buffers[k][n], expected, 1e-3);
+            }
+        }
+        // A clone extracting a part of the windows gives the same buffers
+        std::unique_ptr<AudioReader> clone = audio_reader.clone();
+        clone->initExtraction(parameters);
+        clone->selectWindows(321, 100);
+        size_t nb_buffers = 0;
+        while(clone->getNextBuffer(buffer)) {
+            EXPECT_EQ(buffer, buffers[321 + nb_buffers]);
+            nb_buffers++;
+        }
+        EXPECT_EQ(nb_buffers, 100);
+    }
+    std::remove(filepath.c_str());
+}
+
+
+TEST(WavAudioReaderTest, SameBuffersAsFFmpeg) {
+    std::string filepath = "../../../tests/sound_samples/440Hz_44100Hz_16bit_05sec.wav";
+    std::unique_ptr<AudioReader> audio_reader = create_audio_reader(filepath);
+    EXPECT_NE(dynamic_cast<WavAudioReader*>(audio_reader.get()), nullptr);
+    FFmpegAudioReader ffmpeg_audio_reader(filepath);
+    AudioReaderParameters parameters = DEFAULT_AUDIO_READER_PARAMETERS;
+    audio_reader->initExtraction(parameters);
+    ffmpeg_audio_reader.initExtraction(parameters);
+    std::vector<double> buffer;
+    std::vector<double> ffmpeg_buffer;
+    while(ffmpeg_audio_reader.getNextBuffer(ffmpeg_buffer)) {
+        ASSERT_TRUE(audio_reader->getNextBuffer(buffer));
+        ASSERT_EQ(buffer.size(), ffmpeg_buffer.size());
+        for(size_t k = 0; k < buffer.size(); k++) {
+            EXPECT_NEAR(buffer[k], ffmpeg_buffer[k], 1e-9);
+        }
+    }
+    // Other files are read by FFmpeg
+    std::unique_ptr<AudioReader> mp3_audio_reader = create_audio_reader("../../../tests/sound_samples/whistling_stereo.mp3");
+    EXPECT_NE(dynamic_cast<FFmpegAudioReader*>(mp3_audio_reader.get()), nullptr);
+}
@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include <vector>
+#include "BitMask.hpp"
+
+
+
+static std::vector<bool> getRandomMask(size_t size, int percent_true) {
+    std::vector<bool> values(size);
+    for(size_t k = 0; k < size; k++) {
+        values[k] = (rand() % 100) < percent_true;
+    }
+    return values;
+}
+
+
+/* Test the logical operations against the ones on std::vector<bool> */
+TEST(BitMaskTest, LogicalOperations) {
+    srand(1);
+    for(size_t size : {0, 1, 63, 64, 65, 1000}) {
+        std::vector<bool> valuesA = getRandomMask(size, 30);
+        std::vector<bool> valuesB = getRandomMask(size, 60);
+        BitMask maskA(valuesA);
+        BitMask maskB(valuesB);
+        EXPECT_EQ(maskA.size(), size);
+        EXPECT_EQ(maskA.toVector(), valuesA);
+        std::vector<bool> or_expected(size), and_expected(size), not_expected(size);
+        size_t count_expected = 0;
+        for(size_t k = 0; k < size; k++) {
+            or_expected[k] = valuesA[k] || valuesB[k];
+            and_expected[k] = valuesA[k] && valuesB[k];
+            not_expected[k] = !valuesA[k];
+            count_expected += valuesA[k] ? 1 : 0;
+        }
+        EXPECT_EQ((maskA | maskB).toVector(), or_expected);
+        EXPECT_EQ((maskA & maskB).toVector(), and_expected);
+        EXPECT_EQ((~maskA).toVector(), not_expected);
+        EXPECT_EQ(maskA.count(), count_expected);
+        // The padding bits stay cleared
+        EXPECT_EQ((~maskA).count(), size - count_expected);
+        EXPECT_EQ(~~maskA, maskA);
+        maskA |= maskB;
+        EXPECT_EQ(maskA.toVector(), or_expected);
+    }
+    BitMask maskA(10);
+    BitMask maskB(11);
+    EXPECT_THROW(maskA |= maskB, std::runtime_error);
+    EXPECT_THROW(maskA &= maskB, std::runtime_error);
+}
+
+
+/* Test the runs against a sample by sample search */
+TEST(BitMaskTest, Runs) {
+    srand(2);
+    for(size_t size : {1, 64, 130, 5000}) {
+        for(int percent_true : {0, 5, 50, 95, 100}) {
+            std::vector<bool> values = getRandomMask(size, percent_true);
+            BitMask mask(values);
+            std::vector<std::pair<uint64_t, uint64_t>> runs_expected;
+            for(size_t k = 0; k < size; k++) {
+                if(!values[k] && ((k == 0) || values[k - 1])) {
+                    runs_expected.push_back(std::make_pair(k, k));
+                }
+                if(!values[k]) {
+                    runs_expected.back().second = k + 1;
+                }
+            }
+            EXPECT_EQ(mask.getRuns(false), runs_expected);
+            // Minimum length of the runs
+            std::vector<std::pair<uint64_t, uint64_t>> long_runs_expected;
+            for(auto & run : runs_expected) {
+                if(run.second - run.first >= 3) {
+                    long_runs_expected.push_back(run);
+                }
+            }
+            EXPECT_EQ(mask.getRuns(false, 3), long_runs_expected);
+            EXPECT_EQ((~mask).getRuns(true, 3), long_runs_expected);
+        }
+    }
+    BitMask mask(200, false);
+    mask.set(70, true);
+    EXPECT_EQ(mask.findNext(0, true), 70);
+    EXPECT_EQ(mask.findNext(70, false), 71);
+    EXPECT_EQ(mask.findNext(71, true), 200);
+}
@@ -3,6 +3,7 @@
 #include <cmath>
 #include <vector>
 #include "HistogramStepDetector.hpp"
+#include "HysteresisThreshold.hpp"
 
 
 TEST(compareByLengthTest, Basic) {
@@ -266,3 +267,59 @@ TEST(HistogramStepDetectorTest, InputMask) {
     EXPECT_TRUE(std::isnan(result.notes[2].energy));
 }
 
+
+
+TEST(HistogramStepDetectorTest, AutoEnergyBandwidthSearch) {
+    // Energy track alternating between noise (-60 dB) and notes (-20 dB), with a few quiet notes (-36 dB)
+    // making more than two maxima with the smallest bandwidth
+    srand(7);
+    PitchResult pitch_result;
+    pitch_result.period_s = 10e-3;
+    pitch_result.f0_hz = 32.7032;
+    for(unsigned int k = 0; k < 3000; k++) {
+        double uniform = ((double)rand() + 1.0) / ((double)RAND_MAX + 2.0);
+        double normal = sqrt(-2.0 * log(uniform)) * cos(2.0 * M_PI * (double)rand() / (double)RAND_MAX);
+        double energy_db = ((k / 200) % 2 == 0) ? -60.0 + 4.0 * normal : -20.0 + 6.0 * normal;
+        if((k % 1000) >= 940) {
+            energy_db = -36.0 + 1.5 * normal;
+        }
+        pitch_result.pitch_st.push_back(40.0);
+        pitch_result.energy.push_back(pow(10.0, energy_db / 10.0));
+    }
+    HistogramStepDetector step_detector(pitch_result);
+    step_detector.maskAutoEnergy();
+    std::vector<bool> energy_mask = step_detector.getEnergyMask();
+    double bandwidth = step_detector.getAutoEnergyBandwidth();
+    EXPECT_GE(bandwidth, AUTO_ENERGY_BANDWIDTH_MIN);
+    // Linear search of the bandwidth with the exact evaluation of the density
+    std::vector<double> energy_db;
+    for(const auto & sample : pitch_result.energy) {
+        energy_db.push_back(10.0 * log10(sample));
+    }
+    std::vector<double> points = get_histogram_points(energy_db, AUTO_ENERGY_BINS);
+    double gaussiankdebandwidth = AUTO_ENERGY_BANDWIDTH_MIN;
+    std::vector<double> histo = GaussianKde(energy_db, gaussiankdebandwidth).evaluate(points);
+    std::vector<uint64_t> local_maxs = extract_local_min_max(histo, false, true);
+    while(local_maxs.size() > 2) {
+        gaussiankdebandwidth += AUTO_ENERGY_BANDWIDTH_STEP;
+        histo = GaussianKde(energy_db, gaussiankdebandwidth).evaluate(points);
+        local_maxs = extract_local_min_max(histo, false, true);
+    }
+    ASSERT_EQ(local_maxs.size(), 2);
+    EXPECT_GT(gaussiankdebandwidth, AUTO_ENERGY_BANDWIDTH_MIN + AUTO_ENERGY_BANDWIDTH_STEP);
+    EXPECT_NEAR(bandwidth, gaussiankdebandwidth, AUTO_ENERGY_BANDWIDTH_STEP + 1e-9);
+    auto ind_min = std::min_element(histo.begin() + local_maxs[0], histo.begin() + local_maxs[1]) - histo.begin();
+    // Same threshold within one bin
+    bool same_mask = false;
+    for(int shift = -1; shift <= 1; shift++) {
+        double threshold_db = points[ind_min + shift] + (points[1] - points[0]) / 2.0;
+        HysteresisThreshold thresholding(pow(10.0, (threshold_db - 3.0) / 10.0), pow(10.0, threshold_db / 10.0), true);
+        same_mask = same_mask || (thresholding.perform(pitch_result.energy) == energy_mask);
+    }
+    EXPECT_TRUE(same_mask);
+    // The bandwidth of a previous run gives the same mask
+    HistogramStepDetector step_detector_rerun(pitch_result);
+    step_detector_rerun.maskAutoEnergy(bandwidth);
+    EXPECT_EQ(step_detector_rerun.getAutoEnergyBandwidth(), bandwidth);
+    EXPECT_EQ(step_detector_rerun.getEnergyMask(), energy_mask);
+}
@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "BoundedQueue.hpp"
+
+
+TEST(BoundedQueueTest, FirstInFirstOut) {
+    BoundedQueue<int> queue(10);
+    for(int k = 0; k < 10; k++) {
+        EXPECT_TRUE(queue.push(k));
+    }
+    EXPECT_EQ(queue.size(), 10);
+    int value;
+    for(int k = 0; k < 10; k++) {
+        EXPECT_TRUE(queue.pop(value));
+        EXPECT_EQ(value, k);
+    }
+    EXPECT_EQ(queue.size(), 0);
+}
+
+TEST(BoundedQueueTest, ProducerWaitsWhileFull) {
+    BoundedQueue<int> queue(2);
+    std::atomic<int> nb_pushed(0);
+    std::thread producer([&]() {
+        for(int k = 0; k < 5; k++) {
+            queue.push(k);
+            nb_pushed++;
+        }
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(nb_pushed.load(), 2);
+    EXPECT_EQ(queue.size(), 2);
+    int value;
+    for(int k = 0; k < 5; k++) {
+        EXPECT_TRUE(queue.pop(value));
+        EXPECT_EQ(value, k);
+    }
+    producer.join();
+    EXPECT_EQ(nb_pushed.load(), 5);
+}
+
+TEST(BoundedQueueTest, CloseWakesUpConsumers) {
+    BoundedQueue<int> queue;
+    EXPECT_EQ(queue.getCapacity(), 0);
+    queue.push(1);
+    std::atomic<int> nb_popped(0);
+    std::vector<std::thread> consumers;
+    for(int k = 0; k < 3; k++) {
+        consumers.emplace_back([&]() {
+            int value;
+            while(queue.pop(value)) {
+                nb_popped++;
+            }
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    queue.close();
+    for(auto & consumer : consumers) {
+        consumer.join();
+    }
+    // The remaining items are still given after close
+    EXPECT_EQ(nb_popped.load(), 1);
+    EXPECT_TRUE(queue.isClosed());
+    EXPECT_FALSE(queue.push(2));
+}
+
+TEST(BoundedQueueTest, MultipleProducersAndConsumers) {
+    BoundedQueue<int> queue(4);
+    std::atomic<long> sum(0);
+    std::vector<std::thread> consumers;
+    for(int k = 0; k < 3; k++) {
+        consumers.emplace_back([&]() {
+            int value;
+            while(queue.pop(value)) {
+                sum += value;
+            }
+        });
+    }
+    std::vector<std::thread> producers;
+    for(int k = 0; k < 3; k++) {
+        producers.emplace_back([&]() {
+            for(int value = 1; value <= 1000; value++) {
+                queue.push(value);
+            }
+        });
+    }
+    for(auto & producer : producers) {
+        producer.join();
+    }
+    queue.close();
+    for(auto & consumer : consumers) {
+        consumer.join();
+    }
+    EXPECT_EQ(sum.load(), 3 * 500500);
+}
@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <set>
+#include <stdexcept>
+#include <vector>
+#include "ThreadPool.hpp"
+
+
+TEST(ThreadPoolTest, DefaultNumberOfThreads) {
+    ThreadPool thread_pool;
+    EXPECT_GE(thread_pool.getNumberOfThreads(), 1);
+    ThreadPool thread_pool_3(3);
+    EXPECT_EQ(thread_pool_3.getNumberOfThreads(), 3);
+}
+
+TEST(ThreadPoolTest, ResultsOfTasks) {
+    ThreadPool thread_pool(4);
+    std::vector<std::future<int>> results;
+    for(int k = 0; k < 1000; k++) {
+        results.push_back(thread_pool.submit([k]() { return k * k; }));
+    }
+    for(int k = 0; k < 1000; k++) {
+        EXPECT_EQ(results[k].get(), k * k);
+    }
+}
+
+TEST(ThreadPoolTest, ThreadsAreReused) {
+    ThreadPool thread_pool(2);
+    std::mutex ids_mutex;
+    std::set<std::thread::id> ids;
+    std::vector<std::future<void>> results;
+    for(int k = 0; k < 200; k++) {
+        results.push_back(thread_pool.submit([&]() {
+            std::lock_guard<std::mutex> lock(ids_mutex);
+            ids.insert(std::this_thread::get_id());
+        }));
+    }
+    for(auto & result : results) {
+        result.get();
+    }
+    EXPECT_LE(ids.size(), 2);
+}
+
+TEST(ThreadPoolTest, ExceptionForwardedToFuture) {
+    ThreadPool thread_pool(1);
+    std::future<int> result = thread_pool.submit([]() -> int { throw std::runtime_error("task error"); });
+    EXPECT_THROW(result.get(), std::runtime_error);
+    // The worker is still alive
+    EXPECT_EQ(thread_pool.submit([]() { return 1; }).get(), 1);
+}
+
+TEST(ThreadPoolTest, DestructorRunsRemainingTasks) {
+    std::atomic<int> counter(0);
+    {
+        ThreadPool thread_pool(2);
+        for(int k = 0; k < 100; k++) {
+            thread_pool.submit([&counter]() { counter++; });
+        }
+    }
+    EXPECT_EQ(counter.load(), 100);
+}
+
+TEST(ThreadPoolTest, SubmitWaitsWhileQueueIsFull) {
+    ThreadPool thread_pool(1, 1);
+    EXPECT_EQ(thread_pool.getQueueCapacity(), 1);
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    // One task running, one task waiting in the queue
+    thread_pool.submit([released]() { released.wait(); });
+    thread_pool.submit([]() {});
+    std::atomic<bool> submitted(false);
+    std::thread producer([&]() {
+        thread_pool.submit([]() {});
+        submitted = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_FALSE(submitted.load());
+    release.set_value();
+    producer.join();
+    EXPECT_TRUE(submitted.load());
+}
@@ -80,6 +80,41 @@ TEST(AutoCovarianceTest, SimpleTest) {
     EXPECT_ANY_THROW(autocovariance(data));
 }
 
+// GaussianKde
+TEST(GaussianKdeTest, BinnedMatchesExact) {
+    // Bimodal dataset (noise and signal levels of an energy track in dB)
+    srand(5);
+    std::vector<double> data;
+    for(unsigned int k = 0; k < 20000; k++) {
+        double uniform = ((double)rand() + 1.0) / ((double)RAND_MAX + 2.0);
+        double normal = sqrt(-2.0 * log(uniform)) * cos(2.0 * M_PI * (double)rand() / (double)RAND_MAX);
+        data.push_back((k % 3 == 0) ? -60.0 + 3.0 * normal : -20.0 + 5.0 * normal);
+    }
+    std::vector<double> points = get_histogram_points(data, 1000);
+    double step = points[1] - points[0];
+    for(double bandwidth : {0.05, 0.1, 0.3}) {
+        GaussianKde exact_density(data, bandwidth);
+        GaussianKde binned_density(data, bandwidth, KdeMethod::BINNED);
+        EXPECT_EQ(binned_density.getMethod(), KdeMethod::BINNED);
+        std::vector<double> exact = exact_density.evaluate(points);
+        std::vector<double> binned = binned_density.evaluate(points);
+        ASSERT_EQ(binned.size(), exact.size());
+        // Error bound relative to the maximum of the density
+        double sigma = bandwidth * sqrt(autocovariance(data));
+        double max_density = *std::max_element(exact.begin(), exact.end());
+        double error_max = (step / sigma) * (step / sigma) / 8.0 + 1e-9;
+        for(size_t p = 0; p < exact.size(); p++) {
+            EXPECT_LE(std::abs(binned[p] - exact[p]), error_max * max_density) << bandwidth << " " << p;
+        }
+    }
+    // Points not evenly spaced: exact evaluation
+    std::vector<double> uneven_points = {-70.0, -50.0, -45.0, -10.0};
+    EXPECT_EQ(GaussianKde(data, 0.1, KdeMethod::BINNED).evaluate(uneven_points), GaussianKde(data, 0.1).evaluate(uneven_points));
+    // Kernel much wider than the grid: exact evaluation
+    std::vector<double> narrow_points = {-20.0, -19.99, -19.98, -19.97};
+    EXPECT_EQ(GaussianKde(data, 0.1, KdeMethod::BINNED).evaluate(narrow_points), GaussianKde(data, 0.1).evaluate(narrow_points));
+}
+
 // GaussianKdeHistogram
 // TEST(GaussianKdeHistogramTest, Test) {
 //     std::vector<double> data = {1.3, 4, 5.5, 2.3, 4.9, 9, 0.0, 6.4, 3.2, 2.1, 1.0, 1.1, 8.7, 7.0, 8.9, 7.5, 3.2, 8.2, 0.5, 1.1};
@@ -149,6 +184,100 @@ TEST(MedianFilterTest, OnlyNaNTest) {
         }
     }
 }
+
+TEST(MedianFilterTest, SlidingMatchesSortedWindows) {
+    double nan = std::numeric_limits<double>::quiet_NaN();
+    srand(3);
+    for(uint64_t kernel_size : {3, 5, 11, 51, 201}) {
+        // Random walk with runs of NaN and repeated values
+        std::vector<double> signal(3000);
+        double value = 0.0;
+        for(auto & sample : signal) {
+            value += (double)(rand() % 5) - 2.0;
+            sample = ((rand() % 100) < 30) ? nan : value;
+        }
+        for(uint64_t k = 1000; k < 1000 + kernel_size; k++) {
+            signal[k] = nan;
+        }
+        std::vector<double> result = median_filter(signal, kernel_size);
+        ASSERT_EQ(result.size(), signal.size());
+        // Median of the sorted non-NaN samples of each window
+        uint64_t kMiddle = (kernel_size - 1) / 2;
+        for(uint64_t k = 0; k < signal.size(); k++) {
+            uint64_t start = (k < kMiddle) ? 0 : std::min(k - kMiddle, signal.size() - kernel_size);
+            std::vector<double> window(signal.begin() + start, signal.begin() + start + kernel_size);
+            uint64_t nb_nan = count_nan(window);
+            erase_nan(window);
+            std::sort(window.begin(), window.end());
+            if(nb_nan > kMiddle) {
+                EXPECT_TRUE(std::isnan(result[k])) << k;
+            } else {
+                EXPECT_EQ(result[k], window[(window.size() - 1) / 2]) << k;
+            }
+        }
+    }
+}
+
+TEST(HistogramTest, MatchesBinComparisons) {
+    double nan = std::numeric_limits<double>::quiet_NaN();
+    srand(4);
+    for(uint64_t bins : {1, 7, 100, 1000}) {
+        double range_min = -3.3;
+        double range_max = 12.1;
+        std::vector<double> data(5000);
+        for(auto & sample : data) {
+            sample = range_min - 1.0 + (range_max - range_min + 2.0) * ((double)rand() / RAND_MAX);
+        }
+        Histogram result = histogram(data, bins, range_min, range_max);
+        ASSERT_EQ(result.x.size(), bins + 1);
+        ASSERT_EQ(result.data.size(), bins);
+        // The edges, NaN and the samples outside of the range
+        data.insert(data.end(), result.x.begin(), result.x.end());
+        data.insert(data.end(), {nan, range_min - 1e-12, range_max + 1e-12});
+        result = histogram(data, bins, range_min, range_max);
+        // Samples in [x[k], x[k+1]), the last bin also counts the ones equal to range_max
+        std::vector<double> expected(bins, 0.0);
+        for(const auto & sample : data) {
+            for(uint64_t k = 0; k < bins; k++) {
+                if(((sample >= result.x[k]) && (sample < result.x[k + 1])) || ((k == bins - 1) && (sample == result.x[bins]))) {
+                    expected[k] += 1.0;
+                }
+            }
+        }
+        EXPECT_EQ(result.data, expected);
+        // Reused buffers, accumulated counts
+        Histogram buffer;
+        histogram(data, bins, range_min, range_max, buffer);
+        EXPECT_EQ(buffer.data, expected);
+        histogram(data, bins, range_min, range_max, buffer, true);
+        for(auto & value : expected) {
+            value *= 2.0;
+        }
+        EXPECT_EQ(buffer.data, expected);
+        EXPECT_EQ(buffer.x, result.x);
+        EXPECT_THROW(histogram(data, bins + 1, range_min, range_max, buffer, true), std::runtime_error);
+    }
+    // Empty range: only the samples equal to its bound are counted, in the last bin
+    Histogram result = histogram({1.0, 1.0, 2.0}, 3, 1.0, 1.0);
+    EXPECT_EQ(result.data, std::vector<double>({0.0, 0.0, 2.0}));
+    EXPECT_THROW(histogram({1.0}, 3, 0.0, 1.0), std::runtime_error);
+}
+////////////////////////////////////////////////////////////////////
+
+
+
+// Convolve
+////////////////////////////////////////////////////////////////////
+TEST(ConvolveTest, BufferMatchesReturnedVector) {
+    std::vector<double> signal = {1, 2, 3, 4, 5};
+    std::vector<double> kernel = {1, 2, 1};
+    std::vector<double> result_expected = {4, 8, 12, 16, 14};
+    EXPECT_EQ(convolve(signal, kernel), result_expected);
+    // The previous content of the buffer is replaced
+    std::vector<double> result = {7, 7, 7, 7, 7, 7, 7, 7};
+    convolve(signal, kernel, result);
+    EXPECT_EQ(result, result_expected);
+}
 ////////////////////////////////////////////////////////////////////
 
 
@@ -187,3 +316,59 @@ TEST(most_commun_valueTest, size_t_BasicTest2) {
     EXPECT_EQ(1, mcv);
 };
 ////////////////////////////////////////////////////////////////////
+
+
+
+// RealFFT
+////////////////////////////////////////////////////////////////////
+TEST(RealFFTTest, MatchesDiscreteFourierTransform) {
+    const double pi = 3.14159265358979323846;
+    std::vector<double> signal = {0.3, -1.2, 2.5, 0.7, -0.4, 1.1, 0.0, -2.2, 0.9, 1.5, -0.8};
+    RealFFT fft(16);
+    std::vector<std::complex<double>> spectrum;
+    fft.forward(signal, spectrum);
+    EXPECT_EQ(9, spectrum.size());
+    for(size_t k = 0; k < spectrum.size(); k++) {
+        std::complex<double> expected(0.0, 0.0);
+        for(size_t n = 0; n < signal.size(); n++) {
+            expected += signal[n] * std::polar(1.0, -2.0 * pi * (double)(k * n) / 16.0);
+        }
+        EXPECT_NEAR(expected.real(), spectrum[k].real(), 1e-12);
+        EXPECT_NEAR(expected.imag(), spectrum[k].imag(), 1e-12);
+    }
+}
+
+TEST(RealFFTTest, InverseRecoversSignal) {
+    std::vector<double> signal = {0.3, -1.2, 2.5, 0.7, -0.4, 1.1, 0.0, -2.2};
+    for(uint64_t size : {8, 32, 1024}) {
+        RealFFT fft(size);
+        std::vector<std::complex<double>> spectrum;
+        std::vector<double> result;
+        fft.forward(signal, spectrum);
+        fft.inverse(spectrum, result);
+        EXPECT_EQ(size, result.size());
+        for(size_t k = 0; k < result.size(); k++) {
+            double expected = (k < signal.size()) ? signal[k] : 0.0;
+            EXPECT_NEAR(expected, result[k], 1e-12);
+        }
+    }
+}
+
+TEST(RealFFTTest, InvalidSize) {
+    EXPECT_ANY_THROW(RealFFT(0));
+    EXPECT_ANY_THROW(RealFFT(1));
+    EXPECT_ANY_THROW(RealFFT(12));
+    RealFFT fft(4);
+    std::vector<double> signal(5, 1.0);
+    std::vector<std::complex<double>> spectrum;
+    EXPECT_ANY_THROW(fft.forward(signal, spectrum));
+}
+
+TEST(NextPowerOfTwoTest, BasicsTest) {
+    EXPECT_EQ(1, next_power_of_two(0));
+    EXPECT_EQ(1, next_power_of_two(1));
+    EXPECT_EQ(2, next_power_of_two(2));
+    EXPECT_EQ(4, next_power_of_two(3));
+    EXPECT_EQ(2048, next_power_of_two(1764));
+}
+////////////////////////////////////////////////////////////////////
@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <cmath>
+#include "simd_kernels.hpp"
+
+
+std::vector<double> createKernelTestSignal(size_t size, unsigned int seed) {
+    std::vector<double> signal(size);
+    for(auto & sample : signal) {
+        seed = seed * 1103515245 + 12345;
+        sample = ((seed >> 16) % 20000) / 10000.0 - 1.0;
+    }
+    return signal;
+}
+
+
+TEST(SimdKernelsTest, ScalarAlwaysSupported) {
+    EXPECT_TRUE(instruction_set_supported(InstructionSet::SCALAR));
+    EXPECT_TRUE(instruction_set_supported(get_instruction_set()));
+}
+
+TEST(SimdKernelsTest, AllInstructionSetsMatchScalar) {
+    InstructionSet best = get_instruction_set();
+    std::vector<double> x = createKernelTestSignal(1000, 1);
+    std::vector<double> y = createKernelTestSignal(1000, 2);
+    std::vector<double> result(1000);
+    std::vector<double> expected(1000);
+    for(auto instruction_set : {InstructionSet::SCALAR, InstructionSet::SSE2, InstructionSet::AVX2, InstructionSet::AVX512}) {
+        if(!instruction_set_supported(instruction_set)) {
+            EXPECT_ANY_THROW(set_instruction_set(instruction_set));
+            continue;
+        }
+        set_instruction_set(instruction_set);
+        EXPECT_EQ(instruction_set, get_instruction_set());
+        // Odd sizes and unaligned pointers to test the remaining samples
+        for(size_t offset : {0, 1, 3}) {
+            for(size_t n : {0, 1, 5, 17, 63, 997}) {
+                double sum = 0.0;
+                double dot = 0.0;
+                double sum_squares = 0.0;
+                for(size_t i = offset; i < offset + n; i++) {
+                    sum += x[i];
+                    dot += x[i] * y[i];
+                    sum_squares += x[i] * x[i];
+                    expected[i] = x[i] - 0.25;
+                }
+                EXPECT_NEAR(sum, kernel_sum(x.data() + offset, n), 1e-10);
+                EXPECT_NEAR(dot, kernel_dot(x.data() + offset, y.data() + offset, n), 1e-10);
+                EXPECT_NEAR(sum_squares, kernel_sum_squares(x.data() + offset, n), 1e-10);
+                kernel_subtract(x.data() + offset, 0.25, result.data() + offset, n);
+                for(size_t i = offset; i < offset + n; i++) {
+                    EXPECT_EQ(expected[i], result[i]);
+                }
+            }
+        }
+    }
+    set_instruction_set(best);
+}
+
+TEST(SimdKernelsTest, SinglePrecisionMatchesScalar) {
+    InstructionSet best = get_instruction_set();
+    std::vector<double> x_double = createKernelTestSignal(1000, 3);
+    std::vector<double> y_double = createKernelTestSignal(1000, 4);
+    std::vector<float> x(x_double.begin(), x_double.end());
+    std::vector<float> y(y_double.begin(), y_double.end());
+    std::vector<float> result(1000);
+    for(auto instruction_set : {InstructionSet::SCALAR, InstructionSet::SSE2, InstructionSet::AVX2, InstructionSet::AVX512}) {
+        if(!instruction_set_supported(instruction_set)) {
+            continue;
+        }
+        set_instruction_set(instruction_set);
+        for(size_t offset : {0, 1, 3}) {
+            for(size_t n : {0, 1, 5, 17, 63, 997}) {
+                double sum = 0.0;
+                double dot = 0.0;
+                double sum_squares = 0.0;
+                for(size_t i = offset; i < offset + n; i++) {
+                    sum += x[i];
+                    dot += (double)x[i] * (double)y[i];
+                    sum_squares += (double)x[i] * (double)x[i];
+                }
+                // Accumulation in float lanes
+                EXPECT_NEAR(sum, kernel_sum(x.data() + offset, n), 1e-4);
+                EXPECT_NEAR(dot, kernel_dot(x.data() + offset, y.data() + offset, n), 1e-4);
+                EXPECT_NEAR(sum_squares, kernel_sum_squares(x.data() + offset, n), 1e-4);
+                kernel_subtract(x.data() + offset, 0.25f, result.data() + offset, n);
+                for(size_t i = offset; i < offset + n; i++) {
+                    EXPECT_EQ(x[i] - 0.25f, result[i]);
+                }
+            }
+        }
+    }
+    set_instruction_set(best);
+}